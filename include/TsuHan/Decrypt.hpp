@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace TsuHan
+{
+
+// Pack files are encrypted by XOR-ing every little-endian 32-bit word with
+// PackFileInfo::Key. `Offset` is the byte-offset of the data within the pack
+// so that any sub-range of a pack may be decrypted independently.
+void XORDecrypt(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::uint32_t Key, std::size_t Offset = 0
+);
+
+void XORDecrypt(
+	std::span<std::byte> Data, std::uint32_t Key, std::size_t Offset = 0
+);
+
+// Name of the kernel selected for the current processor
+const char* XORDecryptKernelName();
+
+} // namespace TsuHan
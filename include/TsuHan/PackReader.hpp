@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <TsuHan/TsuHan.hpp>
+
+namespace TsuHan
+{
+
+// Random-access reader for the entries of a single pack file. Entries are
+// decrypted on demand and only the bytes of the requested entry are touched.
+class PackReader
+{
+public:
+	using EntryData = std::shared_ptr<const std::vector<std::byte>>;
+
+	PackReader(
+		const std::filesystem::path& PackPath, const PackFileInfo& Info,
+		std::size_t CacheCapacity = 8
+	);
+	~PackReader();
+
+	PackReader(PackReader&&) noexcept;
+	PackReader& operator=(PackReader&&) noexcept;
+
+	const PackFileInfo& GetInfo() const;
+
+	bool        Contains(const std::string& EntryName) const;
+	std::size_t GetEntrySize(const std::string& EntryName) const;
+
+	// Decrypted contents of an entry. The most recently used entries are kept
+	// in a small cache. The returned data stays valid even after it has been
+	// evicted.
+	EntryData View(const std::string& EntryName);
+
+	// Decrypts up to `Dest.size()` bytes of an entry starting at `Offset`
+	// into `Dest`, returning the amount of bytes written. Does not populate
+	// the cache.
+	std::size_t Read(
+		const std::string& EntryName, std::span<std::byte> Dest,
+		std::size_t Offset = 0
+	) const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> PImpl;
+};
+
+} // namespace TsuHan
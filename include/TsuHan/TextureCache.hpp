@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TsuHan
+{
+
+class ThreadPool;
+
+// How much of an image its alpha hides
+enum class AlphaCoverage : std::uint8_t
+{
+	Opaque,      // All alpha is 255
+	Cutout,      // All alpha is either 0 or 255
+	Translucent, // Any other alpha
+};
+
+// Image files shared by all conversions of a process. Each file is loaded
+// once, and files with identical contents share a single image so that they
+// can be emitted as references to one image. Images are transcoded once per
+// distinct image. Safe to use from multiple threads.
+class TextureCache
+{
+public:
+	struct Image
+	{
+		std::uint64_t          Hash;
+		std::vector<std::byte> Data;
+	};
+	using ImageData = std::shared_ptr<const Image>;
+
+	TextureCache()  = default;
+	~TextureCache() = default;
+
+	TextureCache(const TextureCache&)            = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// Contents of the file at `Path`, which is loaded on first use. Threads
+	// that ask for a file that is still being loaded wait for it. Throws if
+	// the file can not be loaded, in which case the next call tries again.
+	// The contents are kept for the lifetime of the cache, so files must be
+	// complete before they are first asked for and must not change later.
+	ImageData Load(const std::filesystem::path& Path);
+
+	// A TGA image re-encoded as a PNG, which is transcoded on first use.
+	// Throws if the image can not be decoded, on every call.
+	ImageData GetPNG(const ImageData& Source);
+
+	// Coverage of the alpha of a TGA image, which is scanned on first use.
+	// Throws if the image can not be decoded, on every call.
+	AlphaCoverage GetAlphaCoverage(const ImageData& Source);
+
+	// A TGA image baked into a KTX2 file of block-compressed mip levels,
+	// which is written to `Path` on first use. Images with identical contents
+	// share the file of the first one to be baked, whose path is returned.
+	// Blocks are compressed on the pool when one is given. Throws if the
+	// image can not be baked, on every call.
+	std::filesystem::path GetKTX2(
+		const ImageData& Source, const std::filesystem::path& Path,
+		bool KaiserMips, ThreadPool* Pool = nullptr
+	);
+
+	// Amount of files loaded and of distinct images among them
+	std::size_t GetFileCount() const;
+	std::size_t GetImageCount() const;
+
+private:
+	// The image with the same contents as `Data` if there is one, otherwise
+	// a new image of `Data`
+	ImageData Intern(std::vector<std::byte>&& Data);
+
+	mutable std::mutex Mutex;
+
+	// Keyed by the absolute, normalized path of each file
+	std::unordered_map<std::string, std::shared_future<ImageData>> Files;
+	std::unordered_multimap<std::uint64_t, ImageData>              Images;
+
+	// PNG of each image
+	std::unordered_map<const Image*, std::shared_future<ImageData>> PNGs;
+
+	std::unordered_map<const Image*, std::shared_future<AlphaCoverage>>
+		AlphaCoverages;
+
+	// KTX2 file of each image
+	std::unordered_map<
+		const Image*, std::shared_future<std::filesystem::path>>
+		KTX2s;
+};
+
+} // namespace TsuHan
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TsuHan
+{
+
+// Work-stealing thread pool. Every worker owns a queue of tasks and idle
+// workers steal from the queues of other workers. Tasks are started in the
+// order that they were submitted, so submitting the most expensive tasks
+// first keeps a single long task from stalling the end of a run.
+class ThreadPool
+{
+public:
+	// Tracks the completion of a set of tasks. The first exception thrown by
+	// any of its tasks is rethrown by ThreadPool::Wait.
+	class TaskGroup
+	{
+		friend class ThreadPool;
+
+		std::atomic<std::size_t> Pending = 0;
+		std::atomic<std::size_t> Queued  = 0; // Not yet started
+		std::mutex               ErrorMutex;
+		std::exception_ptr       Error;
+	};
+
+	// A ThreadCount of 0 uses all available hardware threads
+	explicit ThreadPool(std::size_t ThreadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&)            = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	std::size_t GetThreadCount() const;
+
+	// Tasks submitted from within a worker are pushed onto that worker's
+	// queue, otherwise queues are filled round-robin
+	void Submit(TaskGroup& Group, std::function<void()> Proc);
+
+	// Blocks until all tasks of the group have finished. The calling thread
+	// executes pending tasks of the group while it waits, so this is safe to
+	// call from within a task. Tasks of other groups are left to the
+	// workers, so that they never run nested within the caller.
+	void Wait(TaskGroup& Group);
+
+private:
+	struct Task
+	{
+		std::function<void()> Proc;
+		TaskGroup*            Group;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex       Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	// Only pops tasks of `Group`, when given
+	bool TryPop(
+		std::size_t QueueIndex, Task& Result, const TaskGroup* Group = nullptr
+	);
+	bool TryGetTask(
+		std::size_t PreferredQueue, Task& Result,
+		const TaskGroup* Group = nullptr
+	);
+	void RunTask(Task& CurTask);
+	void WorkerMain(std::size_t WorkerIndex);
+
+	std::vector<std::unique_ptr<WorkerQueue>> Queues;
+	std::vector<std::thread>                  Workers;
+
+	std::atomic<std::size_t> QueuedCount = 0;
+	std::atomic<std::size_t> NextQueue   = 0;
+
+	std::mutex              SleepMutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable TaskFinished;
+	bool                    Stopping = false;
+};
+
+} // namespace TsuHan
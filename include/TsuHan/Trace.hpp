@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Highest trace level that is compiled in. Traces above this level compile
+// to nothing.
+#ifndef TSUHAN_TRACE_LEVEL
+#define TSUHAN_TRACE_LEVEL 2
+#endif
+
+namespace TsuHan
+{
+
+enum class TraceLevel : std::uint8_t
+{
+	None    = 0,
+	Info    = 1, // Files, entries and chunks
+	Verbose = 2, // Chunk fields and scene hierarchies
+};
+
+// Tracing is off until a level is set
+void SetTraceLevel(TraceLevel Level);
+
+namespace Detail
+{
+extern std::atomic<TraceLevel> CurrentTraceLevel;
+
+#if defined(__GNUC__)
+[[gnu::format(printf, 1, 2)]]
+#endif
+void TraceWrite(const char* Format, ...);
+} // namespace Detail
+
+template<TraceLevel Level>
+inline bool IsTraceEnabled()
+{
+	if constexpr( static_cast<int>(Level) > TSUHAN_TRACE_LEVEL )
+	{
+		return false;
+	}
+	else
+	{
+		return Level
+			<= Detail::CurrentTraceLevel.load(std::memory_order_relaxed);
+	}
+}
+
+// Trace output is gathered in a buffer owned by the calling thread, so that
+// threads never contend or interleave their output. This writes out the
+// calling thread's buffer. Buffers are also written once they fill up and
+// when their thread exits.
+void FlushTrace();
+
+} // namespace TsuHan
+
+// The arguments are only evaluated if the level is enabled
+#define TSUHAN_TRACE(Level, ...)                                             \
+	do                                                                       \
+	{                                                                        \
+		if( ::TsuHan::IsTraceEnabled<::TsuHan::TraceLevel::Level>() )        \
+		{                                                                    \
+			::TsuHan::Detail::TraceWrite(__VA_ARGS__);                       \
+		}                                                                    \
+	} while( false )
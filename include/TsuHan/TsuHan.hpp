@@ -1,16 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <functional>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace TsuHan
 {
 
+class TextureCache;
+class ThreadPool;
+
 namespace HGM
 {
 
@@ -32,8 +42,95 @@ const char* ToString(TagID Tag);
 
 std::size_t GetVertexBufferStride(std::uint16_t VertexAttributeMask);
 
-std::span<const std::byte>
-	ReadFormattedBytes(std::span<const std::byte> Bytes, const char* Format...);
+namespace Detail
+{
+template<std::size_t N>
+struct FixedString
+{
+	char Value[N] = {};
+
+	constexpr FixedString(const char (&String)[N])
+	{
+		std::copy_n(String, N, Value);
+	}
+
+	static constexpr std::size_t Length = N - 1;
+};
+
+// Format tokens:
+//  s: null-terminated string, padded to a multiple of four bytes
+//  l: 32-bit integer
+//  f: 32-bit float
+template<char Token>
+struct FieldType;
+
+template<>
+struct FieldType<'s'>
+{
+	using Type = std::string_view;
+};
+
+template<>
+struct FieldType<'l'>
+{
+	using Type = std::uint32_t;
+};
+
+template<>
+struct FieldType<'f'>
+{
+	using Type = float;
+};
+
+std::string_view ReadString(std::span<const std::byte>& Bytes);
+
+template<typename T>
+T ReadScalar(std::span<const std::byte>& Bytes)
+{
+	if( Bytes.size() < sizeof(T) )
+	{
+		throw std::out_of_range("Chunk field exceeds chunk size");
+	}
+
+	T Result;
+	std::memcpy(&Result, Bytes.data(), sizeof(T));
+	Bytes = Bytes.subspan(sizeof(T));
+	return Result;
+}
+
+template<char Token>
+typename FieldType<Token>::Type ReadField(std::span<const std::byte>& Bytes)
+{
+	if constexpr( Token == 's' )
+	{
+		return ReadString(Bytes);
+	}
+	else
+	{
+		return ReadScalar<typename FieldType<Token>::Type>(Bytes);
+	}
+}
+
+template<FixedString Format, std::size_t... Indices>
+auto Parse(std::span<const std::byte>& Bytes, std::index_sequence<Indices...>)
+{
+	// Braced initialization reads the fields in order
+	return std::tuple<typename FieldType<Format.Value[Indices]>::Type...>{
+		ReadField<Format.Value[Indices]>(Bytes)...
+	};
+}
+} // namespace Detail
+
+// Reads the fields described by `Format` from the front of `Bytes` and
+// advances it past them. Strings are views into `Bytes`.
+// Throws std::out_of_range if a field does not fit within `Bytes`.
+template<Detail::FixedString Format>
+auto Parse(std::span<const std::byte>& Bytes)
+{
+	return Detail::Parse<Format>(
+		Bytes, std::make_index_sequence<Format.Length>()
+	);
+}
 
 struct Chunk
 {
@@ -41,6 +138,48 @@ struct Chunk
 	std::uint32_t Size;
 };
 
+// Locates every chunk of an HGM file in a single pass so that chunks can be
+// looked up by tag or by name and processed in any order. Entries refer to
+// the file's data, which must outlive the index.
+class ChunkIndex
+{
+public:
+	struct Entry
+	{
+		TagID         Tag;
+		std::size_t   Offset; // Offset of the chunk's header within the file
+		std::uint32_t Size;   // Size of the chunk, including its header
+
+		// The first field of every chunk
+		std::string_view Name;
+
+		// The chunk's data, following its header
+		std::span<const std::byte> Data;
+	};
+
+	// Throws std::out_of_range if a chunk exceeds the file
+	explicit ChunkIndex(std::span<const std::byte> FileData);
+
+	// All chunks, in file order
+	std::span<const Entry> GetEntries() const;
+
+	// All chunks with the tag, in file order
+	std::span<const Entry* const> GetEntries(TagID Tag) const;
+
+	// First chunk with the tag and name, nullptr if there is none
+	const Entry* Find(TagID Tag, std::string_view Name) const;
+
+private:
+	struct TagEntries
+	{
+		std::vector<const Entry*>                          Entries;
+		std::unordered_map<std::string_view, const Entry*> NameLUT;
+	};
+
+	std::vector<Entry>                    Entries;
+	std::unordered_map<TagID, TagEntries> TagLUT;
+};
+
 class HGMVisitor
 {
 protected:
@@ -68,8 +207,70 @@ void HGMHandler(
 	HGMVisitor& Visitor
 );
 
+// Visits the chunks of an already indexed file, in file order
+void HGMHandler(const ChunkIndex& Index, HGMVisitor& Visitor);
+
+struct GLTFOptions
+{
+	// Write a binary .glb file rather than a .gltf file with base64-embedded
+	// buffers
+	bool Binary = false;
+
+	// Stores vertex attributes as smaller integer types using
+	// KHR_mesh_quantization. Positions become int16s on a grid that is
+	// mapped back by a transform on each mesh's node.
+	bool Quantize = false;
+
+	// Unrolls the triangle strips of the source into triangle lists without
+	// degenerate triangles, reordered for the post-transform vertex cache
+	bool TriangleList = false;
+
+	// Merges the vertices of a geometry that are equal in all exported
+	// attributes and orders the remaining vertices as they are first used.
+	// Floats closer than `WeldEpsilon` are considered equal when it is not 0.
+	bool  Weld        = false;
+	float WeldEpsilon = 0.0f;
+
+	// Merges the unskinned geometry placed in the scene into a primitive per
+	// material, pre-transformed into world space. The node and mesh of each
+	// merged range is kept in the primitive's extras. Geometry is not
+	// quantized when batching.
+	bool Batch = false;
+
+	// Splits skinned geometry that uses more than `MaxSkinJoints` joints into
+	// primitives that each use at most that many, when not 0. The joints of
+	// each primitive are renumbered into its own palette, which is kept in
+	// the primitive's extras along with a skin of just those joints.
+	// Partitioning works on triangle lists and implies `TriangleList`.
+	std::size_t MaxSkinJoints = 0;
+
+	// Bakes each texture into a .ktx2 file next to it, with a full chain of
+	// BC1 or BC3 mip levels, depending on whether it is translucent. Each
+	// texture refers to its file through KHR_texture_basisu and keeps its
+	// embedded image as the fallback. Mips are box-filtered unless
+	// `KaiserMips` is set.
+	bool BakeTextures = false;
+	bool KaiserMips   = false;
+
+	// Packs the textures of a model that are no larger than `AtlasMaxSize`
+	// pixels in either dimension into shared atlas pages, when not 0. Their
+	// materials refer to the pages through KHR_texture_transform. Textures
+	// drawn onto geometry whose texture coordinates leave [0, 1] are not
+	// packed, as the pages can not repeat them.
+	std::uint32_t AtlasMaxSize = 0;
+
+	// Converts the geometry of a model in parallel when set. The output
+	// does not depend on the thread count.
+	ThreadPool* Pool = nullptr;
+
+	// Loads texture files through this cache when set, which shares them
+	// between conversions. Each conversion uses a cache of its own otherwise.
+	TextureCache* Textures = nullptr;
+};
+
 void HGMToGLTF(
-	std::span<const std::byte> FileData, std::filesystem::path FilePath
+	std::span<const std::byte> FileData, std::filesystem::path FilePath,
+	const GLTFOptions& Options = {}
 );
 
 } // namespace HGM
@@ -80,8 +281,10 @@ struct PackFileInfo
 	const char*   Root;
 	const char*   Extension;
 
-	using HandlerProc
-		= void(std::span<const std::byte>, std::filesystem::path&);
+	using HandlerProc = void(
+		std::span<const std::byte>, std::filesystem::path&,
+		const HGM::GLTFOptions&
+	);
 
 	std::function<HandlerProc> Handler;
 
@@ -1,106 +1,316 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include <TsuHan/PackReader.hpp>
+#include <TsuHan/TextureCache.hpp>
+#include <TsuHan/ThreadPool.hpp>
+#include <TsuHan/Trace.hpp>
 #include <TsuHan/TsuHan.hpp>
 
-#include <mio/mmap.hpp>
+struct EntryJob
+{
+	const TsuHan::PackReader* Reader;
+	const std::string*        FileName;
+	std::size_t               Size;
+};
 
-bool ProcessPack(
-	const std::filesystem::path& DumpPath,
-	const std::filesystem::path& PackPath, TsuHan::PackFileInfo PackInfo
+bool ProcessEntry(
+	const std::filesystem::path& DumpPath, const TsuHan::PackReader& Reader,
+	const std::string& FileName, const TsuHan::HGM::GLTFOptions& GLTFOptions
 );
 
 int main(int argc, char* argv[])
 {
-	const auto Arguments = std::span<char*>(argv, argc);
+	auto Arguments = std::span<char*>(argv, argc).subspan(1);
+
+	std::size_t              ThreadCount = 1;
+	TsuHan::HGM::GLTFOptions GLTFOptions = {};
+	std::uint8_t             Verbosity   = 0;
+
+	// Options
+	while( !Arguments.empty() && Arguments[0][0] == '-' )
+	{
+		const std::string_view CurOption(Arguments[0]);
+		Arguments = Arguments.subspan(1);
+
+		// Reads the value of an option, which must be a number in full
+		const auto ReadNumber = [&](auto& Value) {
+			const std::string_view CurValue(Arguments[0]);
+			Arguments = Arguments.subspan(1);
+
+			const char* const ValueEnd = CurValue.data() + CurValue.size();
+			const auto [ParseEnd, Error]
+				= std::from_chars(CurValue.data(), ValueEnd, Value);
+			if( Error != std::errc() || ParseEnd != ValueEnd )
+			{
+				std::printf(
+					"Invalid value for %s: %s\n", CurOption.data(),
+					CurValue.data()
+				);
+				return false;
+			}
+			return true;
+		};
+
+		// -j N
+		if( CurOption == "-j" && !Arguments.empty() )
+		{
+			if( !ReadNumber(ThreadCount) )
+			{
+				return EXIT_FAILURE;
+			}
+		}
+		// --glb
+		else if( CurOption == "--glb" )
+		{
+			GLTFOptions.Binary = true;
+		}
+		// --quantize
+		else if( CurOption == "--quantize" )
+		{
+			GLTFOptions.Quantize = true;
+		}
+		// --triangles
+		else if( CurOption == "--triangles" )
+		{
+			GLTFOptions.TriangleList = true;
+		}
+		// --batch
+		else if( CurOption == "--batch" )
+		{
+			GLTFOptions.Batch = true;
+		}
+		// --max-joints N
+		else if( CurOption == "--max-joints" && !Arguments.empty() )
+		{
+			if( !ReadNumber(GLTFOptions.MaxSkinJoints) )
+			{
+				return EXIT_FAILURE;
+			}
+		}
+		// --ktx2
+		else if( CurOption == "--ktx2" )
+		{
+			GLTFOptions.BakeTextures = true;
+		}
+		// --kaiser-mips
+		else if( CurOption == "--kaiser-mips" )
+		{
+			GLTFOptions.BakeTextures = true;
+			GLTFOptions.KaiserMips   = true;
+		}
+		// --atlas N
+		else if( CurOption == "--atlas" && !Arguments.empty() )
+		{
+			if( !ReadNumber(GLTFOptions.AtlasMaxSize) )
+			{
+				return EXIT_FAILURE;
+			}
+		}
+		// --weld
+		else if( CurOption == "--weld" )
+		{
+			GLTFOptions.Weld = true;
+		}
+		// --weld-epsilon E
+		else if( CurOption == "--weld-epsilon" && !Arguments.empty() )
+		{
+			GLTFOptions.Weld = true;
+			if( !ReadNumber(GLTFOptions.WeldEpsilon) )
+			{
+				return EXIT_FAILURE;
+			}
+		}
+		// -v, -vv
+		else if( CurOption == "-v" || CurOption == "-vv" )
+		{
+			Verbosity += CurOption.size() - 1;
+		}
+		else
+		{
+			std::printf("Unknown option: %s\n", CurOption.data());
+			return EXIT_FAILURE;
+		}
+	}
 
-	if( Arguments.size() < 3 )
+	if( Arguments.size() < 2 )
 	{
 		// nothing to do
 		return EXIT_SUCCESS;
 	}
 
-	const std::filesystem::path DumpPath(Arguments[1]);
+	// -v traces entries and chunks, -vv also traces their contents
+	const auto MaxVerbosity = std::uint8_t(TsuHan::TraceLevel::Verbose);
+	TsuHan::SetTraceLevel(
+		TsuHan::TraceLevel(std::min(Verbosity, MaxVerbosity))
+	);
+
+	const std::filesystem::path DumpPath(Arguments[0]);
 	std::filesystem::create_directories(DumpPath);
 
-	for( const char* Path : Arguments.subspan(2) )
+	std::vector<std::unique_ptr<TsuHan::PackReader>> Readers;
+	std::vector<EntryJob>                            Jobs;
+
+	for( const char* Path : Arguments.subspan(1) )
 	{
 		const std::filesystem::path CurPath(Path);
 
 		const auto FileName = CurPath.filename().string();
-		std::printf("%s\n", FileName.c_str());
+		TSUHAN_TRACE(Info, "%s\n", FileName.c_str());
 		if( TsuHan::PackInfo.contains(FileName) )
 		{
 			const auto& PackInfo = TsuHan::PackInfo.at(FileName);
-			ProcessPack(DumpPath, CurPath, PackInfo);
+			std::filesystem::create_directories(DumpPath / PackInfo.Root);
+
+			const auto& Reader = Readers.emplace_back(
+				std::make_unique<TsuHan::PackReader>(CurPath, PackInfo, 0)
+			);
+
+			for( const auto& [EntryName, FileSpan] : Reader->GetInfo().Files )
+			{
+				Jobs.push_back(
+					{Reader.get(), &EntryName, Reader->GetEntrySize(EntryName)}
+				);
+			}
 		}
 		else
 		{
-			std::printf("-Unknown file\n");
+			std::printf("%s: Unknown file\n", FileName.c_str());
 		}
 	}
 
+	// Entries that are just written out are all extracted before any entry
+	// is converted, as converting a model reads the textures that other
+	// entries extract. Within each phase, start the most expensive jobs first
+	// so that the phase doesn't end with a long tail on a single thread.
+	std::stable_sort(
+		Jobs.begin(), Jobs.end(),
+		[](const EntryJob& A, const EntryJob& B) {
+			const bool HandlerA = bool(A.Reader->GetInfo().Handler);
+			const bool HandlerB = bool(B.Reader->GetInfo().Handler);
+			if( HandlerA != HandlerB )
+			{
+				return HandlerB;
+			}
+			return A.Size > B.Size;
+		}
+	);
+	const auto FirstConversion = std::find_if(
+		Jobs.begin(), Jobs.end(),
+		[](const EntryJob& CurJob) {
+			return bool(CurJob.Reader->GetInfo().Handler);
+		}
+	);
+
+	TsuHan::ThreadPool Pool(ThreadCount);
+
+	// Entries share the pool with the geometry within them
+	GLTFOptions.Pool = &Pool;
+
+	// Textures are shared by all models. They are only loaded during the
+	// conversion phase, once every texture file has been written out.
+	TsuHan::TextureCache Textures;
+	GLTFOptions.Textures = &Textures;
+
+	const auto RunJobs = [&](std::span<const EntryJob> PhaseJobs) {
+		TsuHan::ThreadPool::TaskGroup Group;
+		for( const EntryJob& CurJob : PhaseJobs )
+		{
+			Pool.Submit(Group, [&DumpPath, &GLTFOptions, CurJob]() {
+				try
+				{
+					ProcessEntry(
+						DumpPath, *CurJob.Reader, *CurJob.FileName,
+						GLTFOptions
+					);
+				}
+				catch( const std::exception& Error )
+				{
+					TsuHan::FlushTrace();
+					std::printf(
+						"-%s: %s\n", CurJob.FileName->c_str(), Error.what()
+					);
+				}
+
+				// Keep the output of each entry together
+				TsuHan::FlushTrace();
+			});
+		}
+		Pool.Wait(Group);
+	};
+
+	RunJobs(std::span(Jobs.begin(), FirstConversion));
+	RunJobs(std::span(FirstConversion, Jobs.end()));
+
+	TSUHAN_TRACE(
+		Info, "%zu texture files, %zu distinct images\n",
+		Textures.GetFileCount(), Textures.GetImageCount()
+	);
+
 	return EXIT_SUCCESS;
 }
 
-bool ProcessPack(
-	const std::filesystem::path& DumpPath,
-	const std::filesystem::path& PackPath, TsuHan::PackFileInfo PackInfo
+bool ProcessEntry(
+	const std::filesystem::path& DumpPath, const TsuHan::PackReader& Reader,
+	const std::string& FileName, const TsuHan::HGM::GLTFOptions& GLTFOptions
 )
-
 {
-	auto MappedFile = mio::mmap_source(PackPath.string().c_str());
+	const TsuHan::PackFileInfo& PackInfo = Reader.GetInfo();
 
-	const auto FileData = std::span<const std::byte>(
-		reinterpret_cast<const std::byte*>(MappedFile.data()), MappedFile.size()
-	);
+	std::filesystem::path OutPath = DumpPath / PackInfo.Root / FileName;
+	OutPath.replace_extension(PackInfo.Extension);
 
-	std::vector<std::byte> DecryptedData(FileData.begin(), FileData.end());
+	std::ofstream OutFile(OutPath, std::ios::binary);
 
-	// Apply the XOR key
+	const std::size_t EntrySize = Reader.GetEntrySize(FileName);
+
+	TSUHAN_TRACE(
+		Info, "-%s (%zu bytes)\n", OutPath.string().c_str(), EntrySize
+	);
+
+	if( PackInfo.Handler )
 	{
-		const auto DecryptedData32 = std::span<std::uint32_t>(
-			reinterpret_cast<std::uint32_t*>(DecryptedData.data()),
-			DecryptedData.size() / 4
+		// Entries with a handler need to be contiguous
+		std::vector<std::byte> EntryBuffer(EntrySize);
+		Reader.Read(FileName, EntryBuffer);
+
+		OutFile.write(
+			reinterpret_cast<const char*>(EntryBuffer.data()),
+			EntryBuffer.size()
 		);
+		OutFile.close();
 
-		for( std::uint32_t& CurWord : DecryptedData32 )
-		{
-			CurWord ^= PackInfo.Key;
-		}
+		PackInfo.Handler(EntryBuffer, OutPath, GLTFOptions);
+		return true;
 	}
 
-	std::filesystem::create_directories(DumpPath / PackInfo.Root);
+	// Everything else is streamed through this small buffer so that memory
+	// usage does not depend on the size of the entry
+	std::array<std::byte, 64 * 1024> StreamBuffer;
 
-	for( const auto& [FileName, FileSpan] : PackInfo.Files )
+	for( std::size_t Offset = 0; Offset < EntrySize;
+		 Offset += StreamBuffer.size() )
 	{
-		std::filesystem::path OutPath = DumpPath / PackInfo.Root / FileName;
-		OutPath.replace_extension(PackInfo.Extension);
-
-		std::ofstream OutFile(OutPath);
-
-		const std::span<const std::byte> CurFileData
-			= std::span(DecryptedData).subspan(FileSpan.Offset, FileSpan.Size);
-
-		std::printf(
-			"-%s (%zu bytes)\n", OutPath.string().c_str(), CurFileData.size()
-		);
+		const std::size_t ChunkSize
+			= Reader.Read(FileName, StreamBuffer, Offset);
 
 		OutFile.write(
-			reinterpret_cast<const char*>(CurFileData.data()),
-			CurFileData.size()
+			reinterpret_cast<const char*>(StreamBuffer.data()), ChunkSize
 		);
-
-		if( PackInfo.Handler )
-		{
-			PackInfo.Handler(CurFileData, OutPath);
-		}
 	}
 
 	return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,154 @@
+#include "Atlas.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// The last shelf of a page, which is the only one that is still filled
+struct AtlasPage
+{
+	std::uint32_t ShelfY      = 0;
+	std::uint32_t ShelfHeight = 0;
+	std::uint32_t ShelfX      = 0;
+	std::uint32_t UsedWidth   = 0;
+};
+
+std::uint32_t AlignUp(std::uint32_t Value, std::uint32_t Alignment)
+{
+	return (Value + Alignment - 1) / Alignment * Alignment;
+}
+
+// Copies an image into its page, repeating its edges across the gutter
+void BlitWithGutter(
+	const Bitmap& Image, Bitmap& Page, std::uint32_t X, std::uint32_t Y,
+	std::uint32_t Gutter
+)
+{
+	const std::uint32_t CellWidth  = AlignUp(Image.Width + 2 * Gutter, Gutter);
+	const std::uint32_t CellHeight = AlignUp(Image.Height + 2 * Gutter, Gutter);
+
+	for( std::uint32_t CellY = 0; CellY < CellHeight; ++CellY )
+	{
+		const std::uint32_t SourceY = std::clamp<std::int64_t>(
+			std::int64_t(CellY) - Gutter, 0, Image.Height - 1
+		);
+		std::byte* DestRow
+			= Page.Pixels.data()
+			+ ((std::size_t(Y) - Gutter + CellY) * Page.Width + X - Gutter) * 4;
+		const std::byte* SourceRow
+			= Image.Pixels.data() + std::size_t(SourceY) * Image.Width * 4;
+
+		for( std::uint32_t CellX = 0; CellX < CellWidth; ++CellX )
+		{
+			const std::uint32_t SourceX = std::clamp<std::int64_t>(
+				std::int64_t(CellX) - Gutter, 0, Image.Width - 1
+			);
+			std::memcpy(DestRow + CellX * 4, SourceRow + SourceX * 4, 4);
+		}
+	}
+}
+
+} // namespace
+
+Atlas PackAtlas(
+	std::span<const Bitmap* const> Images, std::uint32_t PageSize,
+	std::uint32_t Gutter
+)
+{
+	// Cells are whole multiples of the gutter
+	Gutter = std::max(Gutter, 1u);
+	const auto GetCellSize = [Gutter](std::uint32_t Size) {
+		return AlignUp(Size + 2 * Gutter, Gutter);
+	};
+
+	std::vector<std::size_t> Order(Images.size());
+	std::iota(Order.begin(), Order.end(), std::size_t(0));
+	std::stable_sort(
+		Order.begin(), Order.end(), [&](std::size_t A, std::size_t B) {
+			if( Images[A]->Height != Images[B]->Height )
+			{
+				return Images[A]->Height > Images[B]->Height;
+			}
+			return Images[A]->Width > Images[B]->Width;
+		}
+	);
+
+	Atlas                  Result;
+	std::vector<AtlasPage> Pages;
+	Result.Placements.resize(Images.size());
+	for( const std::size_t CurIdx : Order )
+	{
+		const Bitmap& CurImage = *Images[CurIdx];
+		if( CurImage.Channels != 4 )
+		{
+			throw std::invalid_argument("Atlas images need to be RGBA");
+		}
+
+		const std::uint32_t CellWidth  = GetCellSize(CurImage.Width);
+		const std::uint32_t CellHeight = GetCellSize(CurImage.Height);
+		if( CellWidth > PageSize || CellHeight > PageSize )
+		{
+			throw std::out_of_range("Image does not fit an atlas page");
+		}
+
+		// First page with room on its shelf, or for a new shelf below it.
+		// Images are sorted by height, so shelves never grow.
+		std::size_t PageIdx = 0;
+		for( ; PageIdx < Pages.size(); ++PageIdx )
+		{
+			AtlasPage& CurPage = Pages[PageIdx];
+			if( CurPage.ShelfX + CellWidth <= PageSize )
+			{
+				break;
+			}
+			if( CurPage.ShelfY + CurPage.ShelfHeight + CellHeight <= PageSize )
+			{
+				CurPage.ShelfY += CurPage.ShelfHeight;
+				CurPage.ShelfHeight = CellHeight;
+				CurPage.ShelfX      = 0;
+				break;
+			}
+		}
+		if( PageIdx == Pages.size() )
+		{
+			Pages.push_back({0, CellHeight, 0, 0});
+		}
+
+		AtlasPage& CurPage = Pages[PageIdx];
+		Result.Placements[CurIdx]
+			= {std::uint32_t(PageIdx), CurPage.ShelfX + Gutter,
+			   CurPage.ShelfY + Gutter};
+		CurPage.ShelfX += CellWidth;
+		CurPage.UsedWidth = std::max(CurPage.UsedWidth, CurPage.ShelfX);
+	}
+
+	for( const AtlasPage& CurPage : Pages )
+	{
+		Bitmap& NewPage  = Result.Pages.emplace_back();
+		NewPage.Width    = std::bit_ceil(CurPage.UsedWidth);
+		NewPage.Height   = std::bit_ceil(CurPage.ShelfY + CurPage.ShelfHeight);
+		NewPage.Channels = 4;
+		NewPage.Pixels.resize(std::size_t(NewPage.Width) * NewPage.Height * 4);
+	}
+
+	for( std::size_t i = 0; i < Images.size(); ++i )
+	{
+		const AtlasPlacement& CurPlacement = Result.Placements[i];
+		BlitWithGutter(
+			*Images[i], Result.Pages[CurPlacement.Page], CurPlacement.X,
+			CurPlacement.Y, Gutter
+		);
+	}
+
+	return Result;
+}
+
+} // namespace TsuHan
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Image.hpp"
+
+namespace TsuHan
+{
+
+// Where an image was packed, as the top-left of the image within its page
+struct AtlasPlacement
+{
+	std::uint32_t Page = 0;
+	std::uint32_t X    = 0;
+	std::uint32_t Y    = 0;
+};
+
+struct Atlas
+{
+	std::vector<Bitmap>         Pages;
+	std::vector<AtlasPlacement> Placements; // Of each image, in order
+};
+
+// Packs RGBA images onto shelves of pages that are at most `PageSize`
+// pixels wide and high, a power of two, tallest images first. Each image
+// is surrounded by a gutter of `Gutter` pixels that repeats its edges, and
+// its cell is aligned to the gutter. Mip levels down to a gutter of one
+// pixel thus never blend images together. Pages shrink to the smallest
+// power of two that holds their images. Throws if an image does not fit a
+// page.
+Atlas PackAtlas(
+	std::span<const Bitmap* const> Images, std::uint32_t PageSize,
+	std::uint32_t Gutter
+);
+
+} // namespace TsuHan
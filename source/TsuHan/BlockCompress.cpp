@@ -0,0 +1,473 @@
+#include "BlockCompress.hpp"
+
+#include <TsuHan/ThreadPool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+constexpr std::size_t BlockDim    = 4;
+constexpr std::size_t BlockPixels = BlockDim * BlockDim;
+
+// 16 RGBA pixels, row by row
+using PixelBlock = std::array<std::uint8_t, BlockPixels * 4>;
+
+// Power iterations when finding the principal axis of a block's colors
+constexpr std::size_t AxisIterations = 8;
+
+// Rows of blocks claimed at a time, when compressing on a pool
+constexpr std::size_t RowsPerBand = 8;
+
+using Color = std::array<float, 3>;
+
+std::uint16_t ToRGB565(const Color& Value)
+{
+	const auto Quantize = [](float Channel, float Max) {
+		return static_cast<std::uint16_t>(
+			std::lround(std::clamp(Channel, 0.0f, 255.0f) * Max / 255.0f)
+		);
+	};
+	return (Quantize(Value[0], 31.0f) << 11) | (Quantize(Value[1], 63.0f) << 5)
+		 | Quantize(Value[2], 31.0f);
+}
+
+std::array<std::int32_t, 3> FromRGB565(std::uint16_t Value)
+{
+	const std::int32_t R = (Value >> 11) & 0b11111;
+	const std::int32_t G = (Value >> 5) & 0b111111;
+	const std::int32_t B = Value & 0b11111;
+	return {(R << 3) | (R >> 2), (G << 2) | (G >> 4), (B << 3) | (B >> 2)};
+}
+
+// Color endpoints of a BC1 block, with the index of each pixel into the
+// palette of the endpoints
+struct ColorEncoding
+{
+	std::uint16_t Color0  = 0;
+	std::uint16_t Color1  = 0;
+	std::uint32_t Indices = 0;
+	std::uint32_t Error   = std::numeric_limits<std::uint32_t>::max();
+};
+
+// Picks the closest of the four palette colors for each pixel. The first
+// endpoint is kept the larger one, so that the block is in four-color mode.
+ColorEncoding
+	EncodeColors(const PixelBlock& Pixels, const Color& End0, const Color& End1)
+{
+	ColorEncoding Result;
+	Result.Color0 = ToRGB565(End0);
+	Result.Color1 = ToRGB565(End1);
+	if( Result.Color0 < Result.Color1 )
+	{
+		std::swap(Result.Color0, Result.Color1);
+	}
+
+	const auto Color0 = FromRGB565(Result.Color0);
+	const auto Color1 = FromRGB565(Result.Color1);
+
+	std::array<std::array<std::int32_t, 3>, 4> Palette;
+	Palette[0] = Color0;
+	Palette[1] = Color1;
+	for( std::size_t c = 0; c < 3; ++c )
+	{
+		Palette[2][c] = (2 * Color0[c] + Color1[c]) / 3;
+		Palette[3][c] = (Color0[c] + 2 * Color1[c]) / 3;
+	}
+
+	// Equal endpoints would put the block in three-color mode, where the
+	// last index is black
+	const std::size_t PaletteSize
+		= Result.Color0 == Result.Color1 ? 1 : Palette.size();
+
+	Result.Error = 0;
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		std::uint32_t BestError = std::numeric_limits<std::uint32_t>::max();
+		std::uint32_t BestIndex = 0;
+		for( std::size_t j = 0; j < PaletteSize; ++j )
+		{
+			std::uint32_t CurError = 0;
+			for( std::size_t c = 0; c < 3; ++c )
+			{
+				const std::int32_t Delta = Pixels[i * 4 + c] - Palette[j][c];
+				CurError += Delta * Delta;
+			}
+			if( CurError < BestError )
+			{
+				BestError = CurError;
+				BestIndex = j;
+			}
+		}
+		Result.Indices |= BestIndex << (i * 2);
+		Result.Error += BestError;
+	}
+	return Result;
+}
+
+// Fits the endpoints along the principal axis of the colors, then refits
+// them to the chosen indices by least squares
+ColorEncoding CompressColors(const PixelBlock& Pixels)
+{
+	Color Mean = {};
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		for( std::size_t c = 0; c < 3; ++c )
+		{
+			Mean[c] += Pixels[i * 4 + c] / float(BlockPixels);
+		}
+	}
+
+	std::array<float, 6> Covariance = {}; // xx, xy, xz, yy, yz, zz
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		const float X = Pixels[i * 4 + 0] - Mean[0];
+		const float Y = Pixels[i * 4 + 1] - Mean[1];
+		const float Z = Pixels[i * 4 + 2] - Mean[2];
+		Covariance[0] += X * X;
+		Covariance[1] += X * Y;
+		Covariance[2] += X * Z;
+		Covariance[3] += Y * Y;
+		Covariance[4] += Y * Z;
+		Covariance[5] += Z * Z;
+	}
+
+	Color Axis = {1.0f, 1.0f, 1.0f};
+	for( std::size_t i = 0; i < AxisIterations; ++i )
+	{
+		const Color Next = {
+			Covariance[0] * Axis[0] + Covariance[1] * Axis[1]
+				+ Covariance[2] * Axis[2],
+			Covariance[1] * Axis[0] + Covariance[3] * Axis[1]
+				+ Covariance[4] * Axis[2],
+			Covariance[2] * Axis[0] + Covariance[4] * Axis[1]
+				+ Covariance[5] * Axis[2],
+		};
+		const float Length = std::sqrt(
+			Next[0] * Next[0] + Next[1] * Next[1] + Next[2] * Next[2]
+		);
+		if( Length < 1e-6f )
+		{
+			// All pixels are the same color
+			Axis = {};
+			break;
+		}
+		Axis = {Next[0] / Length, Next[1] / Length, Next[2] / Length};
+	}
+
+	float MinProjection = 0.0f;
+	float MaxProjection = 0.0f;
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		float Projection = 0.0f;
+		for( std::size_t c = 0; c < 3; ++c )
+		{
+			Projection += (Pixels[i * 4 + c] - Mean[c]) * Axis[c];
+		}
+		MinProjection = std::min(MinProjection, Projection);
+		MaxProjection = std::max(MaxProjection, Projection);
+	}
+
+	Color End0;
+	Color End1;
+	for( std::size_t c = 0; c < 3; ++c )
+	{
+		End0[c] = Mean[c] + Axis[c] * MaxProjection;
+		End1[c] = Mean[c] + Axis[c] * MinProjection;
+	}
+	ColorEncoding Result = EncodeColors(Pixels, End0, End1);
+	if( Result.Color0 == Result.Color1 )
+	{
+		return Result;
+	}
+
+	// Weight of the first endpoint in each palette color
+	constexpr std::array<float, 4> Weights = {1.0f, 0.0f, 2.0f / 3, 1.0f / 3};
+
+	float A = 0.0f;
+	float B = 0.0f;
+	float C = 0.0f;
+	Color X = {};
+	Color Y = {};
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		const float W = Weights[(Result.Indices >> (i * 2)) & 0b11];
+		A += W * W;
+		B += W * (1.0f - W);
+		C += (1.0f - W) * (1.0f - W);
+		for( std::size_t c = 0; c < 3; ++c )
+		{
+			X[c] += W * Pixels[i * 4 + c];
+			Y[c] += (1.0f - W) * Pixels[i * 4 + c];
+		}
+	}
+
+	const float Determinant = A * C - B * B;
+	if( std::abs(Determinant) > 1e-6f )
+	{
+		for( std::size_t c = 0; c < 3; ++c )
+		{
+			End0[c] = (C * X[c] - B * Y[c]) / Determinant;
+			End1[c] = (A * Y[c] - B * X[c]) / Determinant;
+		}
+		const ColorEncoding Refit = EncodeColors(Pixels, End0, End1);
+		if( Refit.Error < Result.Error )
+		{
+			Result = Refit;
+		}
+	}
+	return Result;
+}
+
+void WriteColors(const ColorEncoding& Encoding, std::byte* Dest)
+{
+	std::memcpy(Dest + 0, &Encoding.Color0, sizeof(std::uint16_t));
+	std::memcpy(Dest + 2, &Encoding.Color1, sizeof(std::uint16_t));
+	std::memcpy(Dest + 4, &Encoding.Indices, sizeof(std::uint32_t));
+}
+
+// Alpha endpoints of a BC4 block, with the index of each pixel into the
+// palette of the endpoints
+struct AlphaEncoding
+{
+	std::uint8_t  Alpha0  = 0;
+	std::uint8_t  Alpha1  = 0;
+	std::uint64_t Indices = 0;
+	std::uint32_t Error   = 0;
+};
+
+// With the first endpoint greater, the palette is made of eight alphas
+// between the endpoints. Otherwise it is six, along with 0 and 255.
+AlphaEncoding EncodeAlpha(
+	const PixelBlock& Pixels, std::uint8_t Alpha0, std::uint8_t Alpha1
+)
+{
+	std::array<std::int32_t, 8> Palette;
+	Palette[0] = Alpha0;
+	Palette[1] = Alpha1;
+	if( Alpha0 > Alpha1 )
+	{
+		for( std::int32_t i = 1; i < 7; ++i )
+		{
+			Palette[i + 1] = ((7 - i) * Alpha0 + i * Alpha1) / 7;
+		}
+	}
+	else
+	{
+		for( std::int32_t i = 1; i < 5; ++i )
+		{
+			Palette[i + 1] = ((5 - i) * Alpha0 + i * Alpha1) / 5;
+		}
+		Palette[6] = 0;
+		Palette[7] = 255;
+	}
+
+	AlphaEncoding Result;
+	Result.Alpha0 = Alpha0;
+	Result.Alpha1 = Alpha1;
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		std::uint32_t BestError = std::numeric_limits<std::uint32_t>::max();
+		std::uint64_t BestIndex = 0;
+		for( std::size_t j = 0; j < Palette.size(); ++j )
+		{
+			const std::int32_t  Delta    = Pixels[i * 4 + 3] - Palette[j];
+			const std::uint32_t CurError = Delta * Delta;
+			if( CurError < BestError )
+			{
+				BestError = CurError;
+				BestIndex = j;
+			}
+		}
+		Result.Indices |= BestIndex << (i * 3);
+		Result.Error += BestError;
+	}
+	return Result;
+}
+
+// Tries both palettes: eight alphas over the full range, and six alphas
+// over the range without 0 and 255, which suits cut-outs
+void CompressAlpha(const PixelBlock& Pixels, std::byte* Dest)
+{
+	std::uint8_t Min      = 255;
+	std::uint8_t Max      = 0;
+	std::uint8_t InnerMin = 255;
+	std::uint8_t InnerMax = 0;
+	for( std::size_t i = 0; i < BlockPixels; ++i )
+	{
+		const std::uint8_t Alpha = Pixels[i * 4 + 3];
+		Min                      = std::min(Min, Alpha);
+		Max                      = std::max(Max, Alpha);
+		if( Alpha != 0 && Alpha != 255 )
+		{
+			InnerMin = std::min(InnerMin, Alpha);
+			InnerMax = std::max(InnerMax, Alpha);
+		}
+	}
+	if( InnerMin > InnerMax )
+	{
+		InnerMin = InnerMax = Min;
+	}
+
+	AlphaEncoding Result = EncodeAlpha(Pixels, Max, Min);
+	if( Result.Error )
+	{
+		const AlphaEncoding Inner = EncodeAlpha(Pixels, InnerMin, InnerMax);
+		if( Inner.Error < Result.Error )
+		{
+			Result = Inner;
+		}
+	}
+
+	Dest[0] = static_cast<std::byte>(Result.Alpha0);
+	Dest[1] = static_cast<std::byte>(Result.Alpha1);
+	for( std::size_t i = 0; i < 6; ++i )
+	{
+		Dest[2 + i] = static_cast<std::byte>(Result.Indices >> (i * 8));
+	}
+}
+
+void CompressBlockRows(
+	const Bitmap& Image, BlockFormat Format, std::size_t FirstRow,
+	std::size_t RowCount, std::byte* Dest
+)
+{
+	const std::size_t BlockCountX = (Image.Width + BlockDim - 1) / BlockDim;
+	const std::size_t BlockSize   = GetBlockSize(Format);
+
+	const auto* Source
+		= reinterpret_cast<const std::uint8_t*>(Image.Pixels.data());
+
+	for( std::size_t BlockY = FirstRow; BlockY < FirstRow + RowCount;
+		 ++BlockY )
+	{
+		for( std::size_t BlockX = 0; BlockX < BlockCountX; ++BlockX )
+		{
+			PixelBlock Pixels;
+			for( std::size_t i = 0; i < BlockPixels; ++i )
+			{
+				const std::size_t X = std::min<std::size_t>(
+					BlockX * BlockDim + i % BlockDim, Image.Width - 1
+				);
+				const std::size_t Y = std::min<std::size_t>(
+					BlockY * BlockDim + i / BlockDim, Image.Height - 1
+				);
+				std::memcpy(
+					&Pixels[i * 4], Source + (Y * Image.Width + X) * 4, 4
+				);
+			}
+
+			std::byte* CurBlock
+				= Dest + (BlockY * BlockCountX + BlockX) * BlockSize;
+			switch( Format )
+			{
+			case BlockFormat::BC1:
+			{
+				WriteColors(CompressColors(Pixels), CurBlock);
+				break;
+			}
+			case BlockFormat::BC3:
+			{
+				CompressAlpha(Pixels, CurBlock);
+				WriteColors(CompressColors(Pixels), CurBlock + 8);
+				break;
+			}
+			}
+		}
+	}
+}
+
+} // namespace
+
+std::size_t GetBlockSize(BlockFormat Format)
+{
+	switch( Format )
+	{
+	case BlockFormat::BC1:
+		return 8;
+	case BlockFormat::BC3:
+		return 16;
+	}
+	return 0;
+}
+
+std::vector<std::byte>
+	CompressBlocks(const Bitmap& Image, BlockFormat Format, ThreadPool* Pool)
+{
+	const std::size_t BlockCountX = (Image.Width + BlockDim - 1) / BlockDim;
+	const std::size_t BlockCountY = (Image.Height + BlockDim - 1) / BlockDim;
+	const std::size_t BandCount
+		= (BlockCountY + RowsPerBand - 1) / RowsPerBand;
+
+	std::vector<std::byte> Result(
+		BlockCountX * BlockCountY * GetBlockSize(Format)
+	);
+	const std::size_t HelperCount
+		= Pool ? std::min(Pool->GetThreadCount(), BandCount) - 1 : 0;
+	if( !HelperCount )
+	{
+		CompressBlockRows(Image, Format, 0, BlockCountY, Result.data());
+		return Result;
+	}
+
+	// Bands of rows are claimed by the calling thread and by helper tasks.
+	// Waiting on the pool instead could have the calling thread pick up a
+	// task that waits for this very image, so it only waits for bands that
+	// are already being compressed. Helpers that start late find no band
+	// left and never touch the image.
+	struct SharedBands
+	{
+		ThreadPool::TaskGroup    Group;
+		std::atomic<std::size_t> NextBand  = 0;
+		std::atomic<std::size_t> DoneBands = 0;
+		std::mutex               Mutex;
+		std::condition_variable  Finished;
+	};
+	const auto Bands = std::make_shared<SharedBands>();
+
+	const auto CompressBands = [&Image, Format, BlockCountY, BandCount,
+								Dest = Result.data()](SharedBands& CurBands) {
+		for( std::size_t Band; (Band = CurBands.NextBand.fetch_add(1))
+							   < BandCount; )
+		{
+			const std::size_t FirstRow = Band * RowsPerBand;
+			CompressBlockRows(
+				Image, Format, FirstRow,
+				std::min(RowsPerBand, BlockCountY - FirstRow), Dest
+			);
+			if( CurBands.DoneBands.fetch_add(1) + 1 == BandCount )
+			{
+				const std::scoped_lock Lock(CurBands.Mutex);
+				CurBands.Finished.notify_all();
+			}
+		}
+	};
+
+	for( std::size_t i = 0; i < HelperCount; ++i )
+	{
+		Pool->Submit(Bands->Group, [Bands, CompressBands]() {
+			CompressBands(*Bands);
+		});
+	}
+	CompressBands(*Bands);
+
+	std::unique_lock Lock(Bands->Mutex);
+	Bands->Finished.wait(Lock, [&] {
+		return Bands->DoneBands.load() == BandCount;
+	});
+
+	return Result;
+}
+
+} // namespace TsuHan
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Image.hpp"
+
+namespace TsuHan
+{
+
+class ThreadPool;
+
+enum class BlockFormat
+{
+	BC1, // Opaque RGB in 8 bytes per 4x4 block
+	BC3, // RGB as BC1 and alpha as BC4, in 16 bytes per 4x4 block
+};
+
+std::size_t GetBlockSize(BlockFormat Format);
+
+// Compresses an RGBA image into 4x4 blocks, row by row. Blocks past the edge
+// of the image repeat its last row and column. The rows of blocks are split
+// across the pool when one is given.
+std::vector<std::byte> CompressBlocks(
+	const Bitmap& Image, BlockFormat Format, ThreadPool* Pool = nullptr
+);
+
+} // namespace TsuHan
@@ -0,0 +1,293 @@
+#include <TsuHan/Decrypt.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)              \
+	|| defined(_M_IX86)
+#define TSUHAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows any intrinsic to be used without enabling the instruction set
+// for the entire translation unit, GCC and Clang need it per-function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TSUHAN_TARGET(Features)
+#else
+#define TSUHAN_TARGET(Features) __attribute__((target(Features)))
+#endif
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// Each kernel decrypts as many bytes as it can with its widest registers and
+// returns the amount of bytes processed. `Key` has already been rotated to
+// line up with the first byte of `Source`.
+using XORKernelProc = std::size_t(
+	const std::byte* Source, std::byte* Dest, std::size_t Size,
+	std::uint32_t Key
+);
+
+std::size_t XORKernelScalar(
+	const std::byte* Source, std::byte* Dest, std::size_t Size,
+	std::uint32_t Key
+)
+{
+	const std::uint64_t Key64 = (std::uint64_t(Key) << 32) | Key;
+
+	std::size_t Offset = 0;
+	for( ; Offset + sizeof(std::uint64_t) <= Size;
+		 Offset += sizeof(std::uint64_t) )
+	{
+		std::uint64_t CurWord;
+		std::memcpy(&CurWord, Source + Offset, sizeof(std::uint64_t));
+		CurWord ^= Key64;
+		std::memcpy(Dest + Offset, &CurWord, sizeof(std::uint64_t));
+	}
+	return Offset;
+}
+
+#if defined(TSUHAN_X86)
+
+TSUHAN_TARGET("sse2")
+std::size_t XORKernelSSE2(
+	const std::byte* Source, std::byte* Dest, std::size_t Size,
+	std::uint32_t Key
+)
+{
+	const __m128i KeyVec = _mm_set1_epi32(static_cast<std::int32_t>(Key));
+
+	std::size_t Offset = 0;
+	for( ; Offset + 4 * sizeof(__m128i) <= Size;
+		 Offset += 4 * sizeof(__m128i) )
+	{
+		const auto* CurSource = reinterpret_cast<const __m128i*>(
+			Source + Offset
+		);
+		auto* CurDest = reinterpret_cast<__m128i*>(Dest + Offset);
+
+		const __m128i Data0 = _mm_loadu_si128(CurSource + 0);
+		const __m128i Data1 = _mm_loadu_si128(CurSource + 1);
+		const __m128i Data2 = _mm_loadu_si128(CurSource + 2);
+		const __m128i Data3 = _mm_loadu_si128(CurSource + 3);
+		_mm_storeu_si128(CurDest + 0, _mm_xor_si128(Data0, KeyVec));
+		_mm_storeu_si128(CurDest + 1, _mm_xor_si128(Data1, KeyVec));
+		_mm_storeu_si128(CurDest + 2, _mm_xor_si128(Data2, KeyVec));
+		_mm_storeu_si128(CurDest + 3, _mm_xor_si128(Data3, KeyVec));
+	}
+
+	for( ; Offset + sizeof(__m128i) <= Size; Offset += sizeof(__m128i) )
+	{
+		const __m128i Data = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(Source + Offset)
+		);
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(Dest + Offset),
+			_mm_xor_si128(Data, KeyVec)
+		);
+	}
+	return Offset;
+}
+
+TSUHAN_TARGET("avx2")
+std::size_t XORKernelAVX2(
+	const std::byte* Source, std::byte* Dest, std::size_t Size,
+	std::uint32_t Key
+)
+{
+	const __m256i KeyVec = _mm256_set1_epi32(static_cast<std::int32_t>(Key));
+
+	std::size_t Offset = 0;
+	for( ; Offset + 4 * sizeof(__m256i) <= Size;
+		 Offset += 4 * sizeof(__m256i) )
+	{
+		const auto* CurSource = reinterpret_cast<const __m256i*>(
+			Source + Offset
+		);
+		auto* CurDest = reinterpret_cast<__m256i*>(Dest + Offset);
+
+		const __m256i Data0 = _mm256_loadu_si256(CurSource + 0);
+		const __m256i Data1 = _mm256_loadu_si256(CurSource + 1);
+		const __m256i Data2 = _mm256_loadu_si256(CurSource + 2);
+		const __m256i Data3 = _mm256_loadu_si256(CurSource + 3);
+		_mm256_storeu_si256(CurDest + 0, _mm256_xor_si256(Data0, KeyVec));
+		_mm256_storeu_si256(CurDest + 1, _mm256_xor_si256(Data1, KeyVec));
+		_mm256_storeu_si256(CurDest + 2, _mm256_xor_si256(Data2, KeyVec));
+		_mm256_storeu_si256(CurDest + 3, _mm256_xor_si256(Data3, KeyVec));
+	}
+
+	for( ; Offset + sizeof(__m256i) <= Size; Offset += sizeof(__m256i) )
+	{
+		const __m256i Data = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(Source + Offset)
+		);
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(Dest + Offset),
+			_mm256_xor_si256(Data, KeyVec)
+		);
+	}
+
+	// Avoid AVX-SSE transition penalties in the caller
+	_mm256_zeroupper();
+	return Offset;
+}
+
+TSUHAN_TARGET("avx512f")
+std::size_t XORKernelAVX512(
+	const std::byte* Source, std::byte* Dest, std::size_t Size,
+	std::uint32_t Key
+)
+{
+	const __m512i KeyVec = _mm512_set1_epi32(static_cast<std::int32_t>(Key));
+
+	std::size_t Offset = 0;
+	for( ; Offset + 4 * sizeof(__m512i) <= Size;
+		 Offset += 4 * sizeof(__m512i) )
+	{
+		const auto* CurSource = reinterpret_cast<const __m512i*>(
+			Source + Offset
+		);
+		auto* CurDest = reinterpret_cast<__m512i*>(Dest + Offset);
+
+		const __m512i Data0 = _mm512_loadu_si512(CurSource + 0);
+		const __m512i Data1 = _mm512_loadu_si512(CurSource + 1);
+		const __m512i Data2 = _mm512_loadu_si512(CurSource + 2);
+		const __m512i Data3 = _mm512_loadu_si512(CurSource + 3);
+		_mm512_storeu_si512(CurDest + 0, _mm512_xor_si512(Data0, KeyVec));
+		_mm512_storeu_si512(CurDest + 1, _mm512_xor_si512(Data1, KeyVec));
+		_mm512_storeu_si512(CurDest + 2, _mm512_xor_si512(Data2, KeyVec));
+		_mm512_storeu_si512(CurDest + 3, _mm512_xor_si512(Data3, KeyVec));
+	}
+
+	for( ; Offset + sizeof(__m512i) <= Size; Offset += sizeof(__m512i) )
+	{
+		const __m512i Data = _mm512_loadu_si512(Source + Offset);
+		_mm512_storeu_si512(Dest + Offset, _mm512_xor_si512(Data, KeyVec));
+	}
+
+	// Remaining whole dwords are handled with a single masked operation
+	const std::size_t DwordCount = (Size - Offset) / sizeof(std::uint32_t);
+	const auto DwordMask = static_cast<__mmask16>((1U << DwordCount) - 1U);
+
+	const __m512i Data
+		= _mm512_maskz_loadu_epi32(DwordMask, Source + Offset);
+	_mm512_mask_storeu_epi32(
+		Dest + Offset, DwordMask, _mm512_xor_si512(Data, KeyVec)
+	);
+	Offset += DwordCount * sizeof(std::uint32_t);
+
+	_mm256_zeroupper();
+	return Offset;
+}
+
+struct CPUFeatures
+{
+	bool SSE2    = false;
+	bool AVX2    = false;
+	bool AVX512F = false;
+};
+
+CPUFeatures DetectCPUFeatures()
+{
+	CPUFeatures Features;
+#if defined(_MSC_VER) && !defined(__clang__)
+	int Registers[4] = {};
+	__cpuid(Registers, 0);
+	const int MaxLeaf = Registers[0];
+
+	__cpuid(Registers, 1);
+	Features.SSE2 = (Registers[3] & (1 << 26)) != 0;
+
+	// The OS must also be saving the upper YMM/ZMM state
+	const bool          OSXSAVE  = (Registers[2] & (1 << 27)) != 0;
+	const std::uint64_t XCR0     = OSXSAVE ? _xgetbv(0) : 0;
+	const bool          YMMState = (XCR0 & 0x06) == 0x06;
+	const bool          ZMMState = (XCR0 & 0xE6) == 0xE6;
+
+	if( MaxLeaf >= 7 )
+	{
+		__cpuidex(Registers, 7, 0);
+		Features.AVX2    = YMMState && (Registers[1] & (1 << 5)) != 0;
+		Features.AVX512F = ZMMState && (Registers[1] & (1 << 16)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	Features.SSE2    = __builtin_cpu_supports("sse2");
+	Features.AVX2    = __builtin_cpu_supports("avx2");
+	Features.AVX512F = __builtin_cpu_supports("avx512f");
+#endif
+	return Features;
+}
+
+#endif
+
+struct XORKernel
+{
+	XORKernelProc* Proc;
+	const char*    Name;
+};
+
+const XORKernel& GetXORKernel()
+{
+	static const XORKernel Kernel = []() -> XORKernel {
+#if defined(TSUHAN_X86)
+		const CPUFeatures Features = DetectCPUFeatures();
+		if( Features.AVX512F )
+		{
+			return {XORKernelAVX512, "AVX-512"};
+		}
+		if( Features.AVX2 )
+		{
+			return {XORKernelAVX2, "AVX2"};
+		}
+		if( Features.SSE2 )
+		{
+			return {XORKernelSSE2, "SSE2"};
+		}
+#endif
+		return {XORKernelScalar, "Scalar"};
+	}();
+	return Kernel;
+}
+
+} // namespace
+
+void XORDecrypt(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::uint32_t Key, std::size_t Offset
+)
+{
+	const std::size_t Size = std::min(Source.size(), Dest.size());
+
+	// Line the key up with the first byte of the data
+	const std::uint32_t CurKey = std::rotr(Key, int(Offset % 4) * 8);
+
+	const std::size_t Processed
+		= GetXORKernel().Proc(Source.data(), Dest.data(), Size, CurKey);
+
+	// Unaligned tail, one byte at a time
+	for( std::size_t i = Processed; i < Size; ++i )
+	{
+		const std::uint32_t KeyByte = std::rotr(CurKey, int(i % 4) * 8);
+		Dest[i] = Source[i] ^ static_cast<std::byte>(KeyByte & 0xFF);
+	}
+}
+
+void XORDecrypt(std::span<std::byte> Data, std::uint32_t Key, std::size_t Offset)
+{
+	XORDecrypt(Data, Data, Key, Offset);
+}
+
+const char* XORDecryptKernelName()
+{
+	return GetXORKernel().Name;
+}
+
+} // namespace TsuHan
@@ -0,0 +1,709 @@
+#include "Deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <queue>
+#include <utility>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// Matches are searched for in the last 32KiB through hash chains of the
+// three bytes that start them. Chains are only followed so far, and a match
+// that is long enough ends the search early.
+constexpr std::size_t WindowSize     = 32768;
+constexpr std::size_t HashBits       = 15;
+constexpr std::size_t MinMatch       = 3;
+constexpr std::size_t MaxMatch       = 258;
+constexpr std::size_t MaxChainLength = 128;
+constexpr std::size_t NiceMatch      = 128;
+
+// Matches of the minimum length this far back cost more than their literals
+constexpr std::size_t FarMinMatch = 4096;
+
+// Symbols of a block before it is Huffman-coded
+constexpr std::size_t MaxBlockSymbols = 1 << 16;
+
+// Bytes of a single stored block
+constexpr std::size_t MaxStoredSize = 65535;
+
+constexpr std::size_t LitLenCount   = 286;
+constexpr std::size_t DistCount     = 30;
+constexpr std::size_t EndOfBlock    = 256;
+constexpr std::size_t MaxCodeLength = 15;
+
+// Code lengths of the literal/length and distance codes are themselves
+// Huffman-coded, with runs of lengths coded as repeats
+constexpr std::size_t CodeLengthCount     = 19;
+constexpr std::size_t MaxCodeLengthLength = 7;
+constexpr std::size_t RepeatPrevious      = 16; // 3 to 6 times
+constexpr std::size_t RepeatZero          = 17; // 3 to 10 times
+constexpr std::size_t RepeatZeroLong      = 18; // 11 to 138 times
+constexpr std::size_t MinRepeat           = 3;
+constexpr std::size_t MinRepeatZeroLong   = 11;
+constexpr std::size_t MaxRepeatPrevious   = 6;
+constexpr std::size_t MaxRepeatZero       = 10;
+constexpr std::size_t MaxRepeatZeroLong   = 138;
+
+// Extra bits of each repeat
+constexpr std::array<std::size_t, 3> CodeLengthExtra = {2, 3, 7};
+
+constexpr std::array<std::uint8_t, CodeLengthCount> CodeLengthOrder = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+constexpr std::array<std::uint16_t, 29> LengthBase = {
+	3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23,  27,
+	31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+constexpr std::array<std::uint8_t, 29> LengthExtra = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+	2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+constexpr std::array<std::uint16_t, DistCount> DistBase = {
+	1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+	33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+constexpr std::array<std::uint8_t, DistCount> DistExtra = {
+	0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+	6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+constexpr std::array<std::uint32_t, 256> CRC32Table = []() {
+	std::array<std::uint32_t, 256> Table = {};
+	for( std::uint32_t i = 0; i < 256; ++i )
+	{
+		std::uint32_t CRC = i;
+		for( std::size_t j = 0; j < 8; ++j )
+		{
+			CRC = (CRC >> 1) ^ ((CRC & 1) ? 0xEDB88320U : 0U);
+		}
+		Table[i] = CRC;
+	}
+	return Table;
+}();
+
+std::uint32_t Adler32(std::span<const std::byte> Data)
+{
+	// Most bytes that can be summed before the sums must be reduced
+	constexpr std::size_t   MaxRun  = 5552;
+	constexpr std::uint32_t Modulus = 65521;
+
+	std::uint32_t A = 1;
+	std::uint32_t B = 0;
+	while( !Data.empty() )
+	{
+		const std::size_t RunSize = std::min(Data.size(), MaxRun);
+		for( const std::byte CurByte : Data.first(RunSize) )
+		{
+			A += std::to_integer<std::uint32_t>(CurByte);
+			B += A;
+		}
+		A %= Modulus;
+		B %= Modulus;
+		Data = Data.subspan(RunSize);
+	}
+	return (B << 16) | A;
+}
+
+// Writes bits least-significant bit first, as deflate packs them
+class BitWriter
+{
+	std::vector<std::byte>& Out;
+	std::uint64_t           Buffer   = 0;
+	std::size_t             BitCount = 0;
+
+public:
+	explicit BitWriter(std::vector<std::byte>& Dest) : Out(Dest)
+	{
+	}
+
+	void Write(std::uint32_t Bits, std::size_t Count)
+	{
+		Buffer |= std::uint64_t(Bits) << BitCount;
+		BitCount += Count;
+		while( BitCount >= 8 )
+		{
+			Out.push_back(static_cast<std::byte>(Buffer));
+			Buffer >>= 8;
+			BitCount -= 8;
+		}
+	}
+
+	// Pads the bits to a whole byte
+	void Align()
+	{
+		if( BitCount )
+		{
+			Write(0, 8 - BitCount);
+		}
+	}
+
+	void WriteBytes(std::span<const std::byte> Bytes)
+	{
+		Out.insert(Out.end(), Bytes.begin(), Bytes.end());
+	}
+};
+
+// A literal byte if `Distance` is 0, otherwise a match of `Length` bytes
+// `Distance` bytes back
+struct Symbol
+{
+	std::uint16_t Length;
+	std::uint16_t Distance;
+};
+
+std::size_t GetLengthCode(std::size_t Length)
+{
+	return std::ranges::upper_bound(LengthBase, Length) - LengthBase.begin()
+		 - 1;
+}
+
+std::size_t GetDistCode(std::size_t Distance)
+{
+	return std::ranges::upper_bound(DistBase, Distance) - DistBase.begin() - 1;
+}
+
+// Code lengths of a Huffman code for `Frequencies` whose codes are at most
+// `MaxLength` bits. At least two symbols get a code, so that the code is
+// always complete.
+std::vector<std::uint8_t> BuildCodeLengths(
+	std::vector<std::uint32_t> Frequencies, std::size_t MaxLength
+)
+{
+	const std::size_t SymbolCount = Frequencies.size();
+
+	std::size_t UsedCount = std::ranges::count_if(
+		Frequencies, [](std::uint32_t Frequency) { return Frequency != 0; }
+	);
+	for( std::size_t i = 0; UsedCount < 2 && i < SymbolCount; ++i )
+	{
+		if( !Frequencies[i] )
+		{
+			Frequencies[i] = 1;
+			++UsedCount;
+		}
+	}
+
+	// Huffman tree, with the symbols as its first nodes. Ties are broken by
+	// node index, so that the code does not depend on the heap.
+	using Node = std::pair<std::uint64_t, std::size_t>; // Weight, Index
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node>> Queue;
+	std::vector<std::size_t> Parents(SymbolCount * 2, 0);
+	for( std::size_t i = 0; i < SymbolCount; ++i )
+	{
+		if( Frequencies[i] )
+		{
+			Queue.emplace(Frequencies[i], i);
+		}
+	}
+	std::size_t NextNode = SymbolCount;
+	while( Queue.size() > 1 )
+	{
+		const Node A = Queue.top();
+		Queue.pop();
+		const Node B = Queue.top();
+		Queue.pop();
+		Parents[A.second] = Parents[B.second] = NextNode;
+		Queue.emplace(A.first + B.first, NextNode++);
+	}
+	const std::size_t Root = NextNode - 1;
+
+	// Amount of codes of each length
+	std::vector<std::uint32_t> LengthCounts(
+		std::max(SymbolCount, MaxLength) + 1, 0
+	);
+	for( std::size_t i = 0; i < SymbolCount; ++i )
+	{
+		if( Frequencies[i] )
+		{
+			std::size_t Depth = 0;
+			for( std::size_t CurNode = i; CurNode != Root;
+				 CurNode              = Parents[CurNode] )
+			{
+				++Depth;
+			}
+			++LengthCounts[Depth];
+		}
+	}
+
+	// Codes that are too long are shortened to the longest length, then
+	// codes are moved down a level until the code is complete again
+	for( std::size_t i = MaxLength + 1; i < LengthCounts.size(); ++i )
+	{
+		LengthCounts[MaxLength] += LengthCounts[i];
+		LengthCounts[i] = 0;
+	}
+	std::uint64_t Total = 0;
+	for( std::size_t i = 1; i <= MaxLength; ++i )
+	{
+		Total += std::uint64_t(LengthCounts[i]) << (MaxLength - i);
+	}
+	while( Total > (std::uint64_t(1) << MaxLength) )
+	{
+		--LengthCounts[MaxLength];
+		for( std::size_t i = MaxLength - 1; i > 0; --i )
+		{
+			if( LengthCounts[i] )
+			{
+				--LengthCounts[i];
+				LengthCounts[i + 1] += 2;
+				break;
+			}
+		}
+		--Total;
+	}
+
+	// The most frequent symbols get the shortest codes
+	std::vector<std::size_t> Symbols;
+	for( std::size_t i = 0; i < SymbolCount; ++i )
+	{
+		if( Frequencies[i] )
+		{
+			Symbols.push_back(i);
+		}
+	}
+	std::ranges::stable_sort(Symbols, [&](std::size_t A, std::size_t B) {
+		return Frequencies[A] > Frequencies[B];
+	});
+
+	std::vector<std::uint8_t> Result(SymbolCount, 0);
+	std::size_t               CurLength = 1;
+	for( const std::size_t CurSymbol : Symbols )
+	{
+		while( !LengthCounts[CurLength] )
+		{
+			++CurLength;
+		}
+		--LengthCounts[CurLength];
+		Result[CurSymbol] = static_cast<std::uint8_t>(CurLength);
+	}
+	return Result;
+}
+
+// Canonical codes of the code lengths, bit-reversed to be written least
+// significant bit first
+std::vector<std::uint16_t> BuildCodes(std::span<const std::uint8_t> Lengths)
+{
+	std::array<std::uint16_t, MaxCodeLength + 1> LengthCounts = {};
+	for( const std::uint8_t CurLength : Lengths )
+	{
+		++LengthCounts[CurLength];
+	}
+	LengthCounts[0] = 0;
+
+	std::array<std::uint16_t, MaxCodeLength + 1> NextCode = {};
+	std::uint16_t                                Code     = 0;
+	for( std::size_t i = 1; i <= MaxCodeLength; ++i )
+	{
+		Code        = (Code + LengthCounts[i - 1]) << 1;
+		NextCode[i] = Code;
+	}
+
+	std::vector<std::uint16_t> Result(Lengths.size(), 0);
+	for( std::size_t i = 0; i < Lengths.size(); ++i )
+	{
+		if( !Lengths[i] )
+		{
+			continue;
+		}
+		const std::uint16_t CurCode = NextCode[Lengths[i]]++;
+		for( std::size_t j = 0; j < Lengths[i]; ++j )
+		{
+			Result[i] |= ((CurCode >> j) & 1) << (Lengths[i] - 1 - j);
+		}
+	}
+	return Result;
+}
+
+void WriteStoredBlocks(
+	BitWriter& Writer, std::span<const std::byte> Data, bool Final
+)
+{
+	do
+	{
+		const std::size_t BlockSize = std::min(Data.size(), MaxStoredSize);
+		const bool        LastBlock = BlockSize == Data.size();
+
+		Writer.Write(Final && LastBlock, 1);
+		Writer.Write(0b00, 2);
+		Writer.Align();
+		Writer.Write(BlockSize, 16);
+		Writer.Write(~BlockSize & 0xFFFF, 16);
+		Writer.WriteBytes(Data.first(BlockSize));
+
+		Data = Data.subspan(BlockSize);
+	} while( !Data.empty() );
+}
+
+// Writes the symbols of `Data` as a block with dynamic Huffman codes, or
+// as stored blocks if that is smaller
+void WriteBlock(
+	BitWriter& Writer, std::span<const Symbol> Symbols,
+	std::span<const std::byte> Data, bool Final
+)
+{
+	std::vector<std::uint32_t> LitLenFrequencies(LitLenCount, 0);
+	std::vector<std::uint32_t> DistFrequencies(DistCount, 0);
+	for( const Symbol& CurSymbol : Symbols )
+	{
+		if( CurSymbol.Distance == 0 )
+		{
+			++LitLenFrequencies[CurSymbol.Length];
+		}
+		else
+		{
+			++LitLenFrequencies[257 + GetLengthCode(CurSymbol.Length)];
+			++DistFrequencies[GetDistCode(CurSymbol.Distance)];
+		}
+	}
+	LitLenFrequencies[EndOfBlock] = 1;
+
+	const std::vector<std::uint8_t> LitLenLengths
+		= BuildCodeLengths(LitLenFrequencies, MaxCodeLength);
+	const std::vector<std::uint8_t> DistLengths
+		= BuildCodeLengths(DistFrequencies, MaxCodeLength);
+
+	// Trailing unused codes are left out
+	std::size_t LitLenUsed = LitLenCount;
+	while( LitLenUsed > 257 && !LitLenLengths[LitLenUsed - 1] )
+	{
+		--LitLenUsed;
+	}
+	std::size_t DistUsed = DistCount;
+	while( DistUsed > 1 && !DistLengths[DistUsed - 1] )
+	{
+		--DistUsed;
+	}
+
+	// Run-length coded code lengths, as pairs of code length symbol and
+	// repeat count
+	std::vector<std::uint8_t> AllLengths(
+		LitLenLengths.begin(), LitLenLengths.begin() + LitLenUsed
+	);
+	AllLengths.insert(
+		AllLengths.end(), DistLengths.begin(), DistLengths.begin() + DistUsed
+	);
+
+	std::vector<std::pair<std::uint8_t, std::uint8_t>> LengthSymbols;
+	std::vector<std::uint32_t> CodeLengthFrequencies(CodeLengthCount, 0);
+	for( std::size_t i = 0; i < AllLengths.size(); )
+	{
+		const std::uint8_t CurLength = AllLengths[i];
+		std::size_t        RunLength = 1;
+		while( i + RunLength < AllLengths.size()
+			   && AllLengths[i + RunLength] == CurLength )
+		{
+			++RunLength;
+		}
+
+		std::size_t Consumed = 1;
+		if( CurLength == 0 && RunLength >= MinRepeatZeroLong )
+		{
+			Consumed = std::min(RunLength, MaxRepeatZeroLong);
+			LengthSymbols.emplace_back(RepeatZeroLong, Consumed);
+		}
+		else if( CurLength == 0 && RunLength >= MinRepeat )
+		{
+			Consumed = std::min(RunLength, MaxRepeatZero);
+			LengthSymbols.emplace_back(RepeatZero, Consumed);
+		}
+		else if( i > 0 && AllLengths[i - 1] == CurLength
+				 && RunLength >= MinRepeat )
+		{
+			Consumed = std::min(RunLength, MaxRepeatPrevious);
+			LengthSymbols.emplace_back(RepeatPrevious, Consumed);
+		}
+		else
+		{
+			LengthSymbols.emplace_back(CurLength, 1);
+		}
+		++CodeLengthFrequencies[LengthSymbols.back().first];
+		i += Consumed;
+	}
+
+	const std::vector<std::uint8_t> CodeLengthLengths
+		= BuildCodeLengths(CodeLengthFrequencies, MaxCodeLengthLength);
+	std::size_t CodeLengthUsed = CodeLengthCount;
+	while( CodeLengthUsed > 4
+		   && !CodeLengthLengths[CodeLengthOrder[CodeLengthUsed - 1]] )
+	{
+		--CodeLengthUsed;
+	}
+
+	// Size of the block in bits, to compare against storing it
+	std::size_t BlockBits = 3 + 5 + 5 + 4 + 3 * CodeLengthUsed;
+	for( const auto& [CurSymbol, CurCount] : LengthSymbols )
+	{
+		BlockBits += CodeLengthLengths[CurSymbol];
+		if( CurSymbol >= RepeatPrevious )
+		{
+			BlockBits += CodeLengthExtra[CurSymbol - RepeatPrevious];
+		}
+	}
+	for( const Symbol& CurSymbol : Symbols )
+	{
+		if( CurSymbol.Distance == 0 )
+		{
+			BlockBits += LitLenLengths[CurSymbol.Length];
+		}
+		else
+		{
+			const std::size_t LengthCode = GetLengthCode(CurSymbol.Length);
+			const std::size_t DistCode   = GetDistCode(CurSymbol.Distance);
+			BlockBits += LitLenLengths[257 + LengthCode]
+					   + LengthExtra[LengthCode] + DistLengths[DistCode]
+					   + DistExtra[DistCode];
+		}
+	}
+	BlockBits += LitLenLengths[EndOfBlock];
+
+	const std::size_t StoredBlockCount = std::max<std::size_t>(
+		1, (Data.size() + MaxStoredSize - 1) / MaxStoredSize
+	);
+	const std::size_t StoredBits
+		= (Data.size() + StoredBlockCount * 5) * 8 + 7;
+	if( StoredBits <= BlockBits )
+	{
+		WriteStoredBlocks(Writer, Data, Final);
+		return;
+	}
+
+	const std::vector<std::uint16_t> LitLenCodes = BuildCodes(LitLenLengths);
+	const std::vector<std::uint16_t> DistCodes   = BuildCodes(DistLengths);
+	const std::vector<std::uint16_t> CodeLengthCodes
+		= BuildCodes(CodeLengthLengths);
+
+	Writer.Write(Final, 1);
+	Writer.Write(0b10, 2);
+	Writer.Write(LitLenUsed - 257, 5);
+	Writer.Write(DistUsed - 1, 5);
+	Writer.Write(CodeLengthUsed - 4, 4);
+	for( std::size_t i = 0; i < CodeLengthUsed; ++i )
+	{
+		Writer.Write(CodeLengthLengths[CodeLengthOrder[i]], 3);
+	}
+
+	for( const auto& [CurSymbol, CurCount] : LengthSymbols )
+	{
+		Writer.Write(CodeLengthCodes[CurSymbol], CodeLengthLengths[CurSymbol]);
+		if( CurSymbol >= RepeatPrevious )
+		{
+			const std::size_t MinCount
+				= CurSymbol == RepeatZeroLong ? MinRepeatZeroLong : MinRepeat;
+			Writer.Write(
+				CurCount - MinCount, CodeLengthExtra[CurSymbol - RepeatPrevious]
+			);
+		}
+	}
+
+	for( const Symbol& CurSymbol : Symbols )
+	{
+		if( CurSymbol.Distance == 0 )
+		{
+			Writer.Write(
+				LitLenCodes[CurSymbol.Length], LitLenLengths[CurSymbol.Length]
+			);
+			continue;
+		}
+
+		const std::size_t LengthCode = GetLengthCode(CurSymbol.Length);
+		Writer.Write(
+			LitLenCodes[257 + LengthCode], LitLenLengths[257 + LengthCode]
+		);
+		Writer.Write(
+			CurSymbol.Length - LengthBase[LengthCode], LengthExtra[LengthCode]
+		);
+
+		const std::size_t DistCode = GetDistCode(CurSymbol.Distance);
+		Writer.Write(DistCodes[DistCode], DistLengths[DistCode]);
+		Writer.Write(
+			CurSymbol.Distance - DistBase[DistCode], DistExtra[DistCode]
+		);
+	}
+	Writer.Write(LitLenCodes[EndOfBlock], LitLenLengths[EndOfBlock]);
+}
+
+// Finds repeated strings of the data with hash chains
+class Matcher
+{
+	std::span<const std::byte> Data;
+	std::vector<std::ptrdiff_t> Head;
+	std::vector<std::ptrdiff_t> Prev;
+
+	std::size_t Hash(std::size_t Offset) const
+	{
+		std::uint32_t Bytes = 0;
+		std::memcpy(&Bytes, Data.data() + Offset, MinMatch);
+		return (Bytes * 2654435761U) >> (32 - HashBits);
+	}
+
+	std::size_t MatchLength(std::size_t A, std::size_t B, std::size_t Max) const
+	{
+		std::size_t Length = 0;
+		if constexpr( std::endian::native == std::endian::little )
+		{
+			while( Length + 8 <= Max )
+			{
+				std::uint64_t WordA;
+				std::uint64_t WordB;
+				std::memcpy(&WordA, Data.data() + A + Length, 8);
+				std::memcpy(&WordB, Data.data() + B + Length, 8);
+				if( WordA != WordB )
+				{
+					return Length + std::countr_zero(WordA ^ WordB) / 8;
+				}
+				Length += 8;
+			}
+		}
+		while( Length < Max && Data[A + Length] == Data[B + Length] )
+		{
+			++Length;
+		}
+		return Length;
+	}
+
+public:
+	explicit Matcher(std::span<const std::byte> Source)
+		: Data(Source), Head(std::size_t(1) << HashBits, -1),
+		  Prev(WindowSize, -1)
+	{
+	}
+
+	void Insert(std::size_t Offset)
+	{
+		if( Offset + MinMatch > Data.size() )
+		{
+			return;
+		}
+		std::ptrdiff_t& CurHead          = Head[Hash(Offset)];
+		Prev[Offset & (WindowSize - 1)] = CurHead;
+		CurHead                          = Offset;
+	}
+
+	// Longest earlier match of the bytes at `Offset`, which has not been
+	// inserted yet. The length is 0 if there is no match.
+	Symbol Find(std::size_t Offset) const
+	{
+		Symbol Result = {0, 0};
+		if( Offset + MinMatch > Data.size() )
+		{
+			return Result;
+		}
+
+		const std::size_t Max = std::min(MaxMatch, Data.size() - Offset);
+
+		std::ptrdiff_t Candidate = Head[Hash(Offset)];
+		for( std::size_t Chain = 0; Chain < MaxChainLength && Candidate >= 0
+									&& Offset - Candidate <= WindowSize;
+			 ++Chain )
+		{
+			const std::size_t Length = MatchLength(Candidate, Offset, Max);
+			if( Length > Result.Length )
+			{
+				Result.Length   = Length;
+				Result.Distance = Offset - Candidate;
+				if( Length >= NiceMatch || Length == Max )
+				{
+					break;
+				}
+			}
+			Candidate = Prev[Candidate & (WindowSize - 1)];
+		}
+
+		if( Result.Length < MinMatch
+			|| (Result.Length == MinMatch && Result.Distance > FarMinMatch) )
+		{
+			Result = {0, 0};
+		}
+		return Result;
+	}
+};
+
+} // namespace
+
+std::vector<std::byte> ZlibCompress(std::span<const std::byte> Data)
+{
+	std::vector<std::byte> Result;
+	Result.reserve(Data.size() / 2 + 64);
+
+	// Deflate with a 32KiB window, default compression
+	Result.push_back(std::byte{0x78});
+	Result.push_back(std::byte{0x9C});
+
+	BitWriter Writer(Result);
+	Matcher   Matches(Data);
+
+	std::vector<Symbol> Symbols;
+	Symbols.reserve(MaxBlockSymbols);
+	std::size_t BlockStart = 0;
+
+	for( std::size_t Offset = 0; Offset < Data.size(); )
+	{
+		const Symbol CurMatch = Matches.Find(Offset);
+		Matches.Insert(Offset);
+
+		// A longer match at the next byte is worth a literal
+		bool Deferred = false;
+		if( CurMatch.Length && CurMatch.Length < NiceMatch )
+		{
+			Deferred = Matches.Find(Offset + 1).Length > CurMatch.Length;
+		}
+
+		if( CurMatch.Length && !Deferred )
+		{
+			Symbols.push_back(CurMatch);
+			for( std::size_t i = 1; i < CurMatch.Length; ++i )
+			{
+				Matches.Insert(Offset + i);
+			}
+			Offset += CurMatch.Length;
+		}
+		else
+		{
+			Symbols.push_back(
+				{std::to_integer<std::uint16_t>(Data[Offset]), 0}
+			);
+			++Offset;
+		}
+
+		if( Symbols.size() >= MaxBlockSymbols )
+		{
+			WriteBlock(
+				Writer, Symbols, Data.subspan(BlockStart, Offset - BlockStart),
+				false
+			);
+			Symbols.clear();
+			BlockStart = Offset;
+		}
+	}
+	WriteBlock(Writer, Symbols, Data.subspan(BlockStart), true);
+	Writer.Align();
+
+	const std::uint32_t Checksum = Adler32(Data);
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Result.push_back(static_cast<std::byte>(Checksum >> (24 - i * 8)));
+	}
+
+	return Result;
+}
+
+std::uint32_t CRC32(std::span<const std::byte> Data, std::uint32_t CRC)
+{
+	CRC = ~CRC;
+	for( const std::byte CurByte : Data )
+	{
+		const std::uint32_t Value = std::to_integer<std::uint32_t>(CurByte);
+		CRC = (CRC >> 8) ^ CRC32Table[(CRC ^ Value) & 0xFF];
+	}
+	return ~CRC;
+}
+
+} // namespace TsuHan
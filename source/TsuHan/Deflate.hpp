@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace TsuHan
+{
+
+// Compresses `Data` into a zlib stream of deflate blocks, each of which
+// uses dynamic Huffman codes or is stored as-is, whichever is smaller
+std::vector<std::byte> ZlibCompress(std::span<const std::byte> Data);
+
+// CRC-32 of `Data`, continued from the CRC-32 of any preceding data
+std::uint32_t CRC32(std::span<const std::byte> Data, std::uint32_t CRC = 0);
+
+} // namespace TsuHan
@@ -0,0 +1,784 @@
+#include "GLTFWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+class JSONWriter
+{
+	std::string* Out;
+	const bool   Pretty;
+
+	// Whether the current object/array has had any elements written to it
+	std::vector<bool> HasElements;
+	bool              AfterKey = false;
+
+	void NewLine()
+	{
+		if( Pretty )
+		{
+			Out->push_back('\n');
+			Out->append(HasElements.size() * 2, ' ');
+		}
+	}
+
+	void BeginElement()
+	{
+		if( AfterKey )
+		{
+			AfterKey = false;
+			return;
+		}
+		if( HasElements.empty() )
+		{
+			return;
+		}
+		if( HasElements.back() )
+		{
+			Out->push_back(',');
+		}
+		HasElements.back() = true;
+		NewLine();
+	}
+
+	void End(char Close)
+	{
+		const bool HadElements = HasElements.back();
+		HasElements.pop_back();
+		if( HadElements )
+		{
+			NewLine();
+		}
+		Out->push_back(Close);
+	}
+
+	void Escaped(std::string_view Value)
+	{
+		Out->push_back('"');
+		for( const char CurChar : Value )
+		{
+			switch( CurChar )
+			{
+			case '"':
+				Out->append("\\\"");
+				break;
+			case '\\':
+				Out->append("\\\\");
+				break;
+			case '\n':
+				Out->append("\\n");
+				break;
+			case '\r':
+				Out->append("\\r");
+				break;
+			case '\t':
+				Out->append("\\t");
+				break;
+			default:
+			{
+				if( static_cast<unsigned char>(CurChar) < 0x20 )
+				{
+					char Escape[8];
+					std::snprintf(
+						Escape, sizeof(Escape), "\\u%04x",
+						static_cast<unsigned char>(CurChar)
+					);
+					Out->append(Escape);
+				}
+				else
+				{
+					Out->push_back(CurChar);
+				}
+				break;
+			}
+			}
+		}
+		Out->push_back('"');
+	}
+
+public:
+	JSONWriter(std::string& Output, bool PrettyPrint)
+		: Out(&Output), Pretty(PrettyPrint)
+	{
+	}
+
+	void SetOutput(std::string& Output)
+	{
+		Out = &Output;
+	}
+
+	void BeginObject()
+	{
+		BeginElement();
+		Out->push_back('{');
+		HasElements.push_back(false);
+	}
+
+	void EndObject()
+	{
+		End('}');
+	}
+
+	void BeginArray()
+	{
+		BeginElement();
+		Out->push_back('[');
+		HasElements.push_back(false);
+	}
+
+	void EndArray()
+	{
+		End(']');
+	}
+
+	void Key(std::string_view Name)
+	{
+		BeginElement();
+		Escaped(Name);
+		Out->append(Pretty ? ": " : ":");
+		AfterKey = true;
+	}
+
+	void String(std::string_view Value)
+	{
+		BeginElement();
+		Escaped(Value);
+	}
+
+	// Opens a string value whose contents are appended directly to the output
+	void BeginRawString()
+	{
+		BeginElement();
+		Out->push_back('"');
+	}
+
+	void EndRawString()
+	{
+		Out->push_back('"');
+	}
+
+	void Number(double Value)
+	{
+		BeginElement();
+		if( !std::isfinite(Value) )
+		{
+			Out->append("0");
+			return;
+		}
+		char Buffer[32];
+		const auto Result
+			= std::to_chars(std::begin(Buffer), std::end(Buffer), Value);
+		Out->append(Buffer, Result.ptr);
+	}
+
+	void Integer(std::int64_t Value)
+	{
+		BeginElement();
+		Out->append(std::to_string(Value));
+	}
+
+	void Bool(bool Value)
+	{
+		BeginElement();
+		Out->append(Value ? "true" : "false");
+	}
+
+	void Null()
+	{
+		BeginElement();
+		Out->append("null");
+	}
+};
+
+void WriteValue(JSONWriter& JSON, const tinygltf::Value& Value)
+{
+	switch( Value.Type() )
+	{
+	case tinygltf::BOOL_TYPE:
+		JSON.Bool(Value.Get<bool>());
+		break;
+	case tinygltf::INT_TYPE:
+		JSON.Integer(Value.Get<int>());
+		break;
+	case tinygltf::REAL_TYPE:
+		JSON.Number(Value.Get<double>());
+		break;
+	case tinygltf::STRING_TYPE:
+		JSON.String(Value.Get<std::string>());
+		break;
+	case tinygltf::ARRAY_TYPE:
+	{
+		JSON.BeginArray();
+		for( std::size_t i = 0; i < Value.ArrayLen(); ++i )
+		{
+			WriteValue(JSON, Value.Get(i));
+		}
+		JSON.EndArray();
+		break;
+	}
+	case tinygltf::OBJECT_TYPE:
+	{
+		JSON.BeginObject();
+		for( const std::string& CurKey : Value.Keys() )
+		{
+			JSON.Key(CurKey);
+			WriteValue(JSON, Value.Get(CurKey));
+		}
+		JSON.EndObject();
+		break;
+	}
+	default:
+	{
+		JSON.Null();
+		break;
+	}
+	}
+}
+
+void WriteExtensionsAndExtras(
+	JSONWriter& JSON, const tinygltf::ExtensionMap& Extensions,
+	const tinygltf::Value& Extras
+)
+{
+	if( !Extensions.empty() )
+	{
+		JSON.Key("extensions");
+		JSON.BeginObject();
+		for( const auto& [Name, Value] : Extensions )
+		{
+			JSON.Key(Name);
+			// Extensions such as KHR_materials_unlit are declared with an
+			// empty value
+			if( Value.Type() == tinygltf::NULL_TYPE )
+			{
+				JSON.BeginObject();
+				JSON.EndObject();
+				continue;
+			}
+			WriteValue(JSON, Value);
+		}
+		JSON.EndObject();
+	}
+
+	if( Extras.Type() != tinygltf::NULL_TYPE )
+	{
+		JSON.Key("extras");
+		WriteValue(JSON, Extras);
+	}
+}
+
+void WriteName(JSONWriter& JSON, const std::string& Name)
+{
+	if( !Name.empty() )
+	{
+		JSON.Key("name");
+		JSON.String(Name);
+	}
+}
+
+void WriteIndex(JSONWriter& JSON, std::string_view Key, int Index)
+{
+	if( Index >= 0 )
+	{
+		JSON.Key(Key);
+		JSON.Integer(Index);
+	}
+}
+
+template<typename T>
+void WriteNumbers(
+	JSONWriter& JSON, std::string_view Key, const std::vector<T>& Numbers
+)
+{
+	if( Numbers.empty() )
+	{
+		return;
+	}
+	JSON.Key(Key);
+	JSON.BeginArray();
+	for( const T& CurNumber : Numbers )
+	{
+		if constexpr( std::is_integral_v<T> )
+		{
+			JSON.Integer(CurNumber);
+		}
+		else
+		{
+			JSON.Number(CurNumber);
+		}
+	}
+	JSON.EndArray();
+}
+
+void WriteTextureInfo(
+	JSONWriter& JSON, std::string_view Key,
+	const tinygltf::TextureInfo& TextureInfo
+)
+{
+	if( TextureInfo.index < 0 )
+	{
+		return;
+	}
+	JSON.Key(Key);
+	JSON.BeginObject();
+	WriteIndex(JSON, "index", TextureInfo.index);
+	if( TextureInfo.texCoord != 0 )
+	{
+		JSON.Key("texCoord");
+		JSON.Integer(TextureInfo.texCoord);
+	}
+	WriteExtensionsAndExtras(JSON, TextureInfo.extensions, TextureInfo.extras);
+	JSON.EndObject();
+}
+
+const char* AccessorTypeName(int Type)
+{
+	switch( Type )
+	{
+	case TINYGLTF_TYPE_SCALAR:
+		return "SCALAR";
+	case TINYGLTF_TYPE_VEC2:
+		return "VEC2";
+	case TINYGLTF_TYPE_VEC3:
+		return "VEC3";
+	case TINYGLTF_TYPE_VEC4:
+		return "VEC4";
+	case TINYGLTF_TYPE_MAT2:
+		return "MAT2";
+	case TINYGLTF_TYPE_MAT3:
+		return "MAT3";
+	case TINYGLTF_TYPE_MAT4:
+		return "MAT4";
+	default:
+		return "SCALAR";
+	}
+}
+
+// Writes everything but the buffers
+void WriteModel(JSONWriter& JSON, const tinygltf::Model& Model)
+{
+	JSON.Key("asset");
+	JSON.BeginObject();
+	if( !Model.asset.generator.empty() )
+	{
+		JSON.Key("generator");
+		JSON.String(Model.asset.generator);
+	}
+	JSON.Key("version");
+	JSON.String(Model.asset.version);
+	JSON.EndObject();
+
+	const auto WriteStrings = [&](std::string_view Key,
+								  const std::vector<std::string>& Strings) {
+		if( Strings.empty() )
+		{
+			return;
+		}
+		JSON.Key(Key);
+		JSON.BeginArray();
+		for( const std::string& CurString : Strings )
+		{
+			JSON.String(CurString);
+		}
+		JSON.EndArray();
+	};
+	WriteStrings("extensionsUsed", Model.extensionsUsed);
+	WriteStrings("extensionsRequired", Model.extensionsRequired);
+
+	WriteIndex(JSON, "scene", Model.defaultScene);
+
+	// Writes an array of objects, only if it is non-empty
+	const auto WriteArray
+		= [&](std::string_view Key, const auto& Objects, const auto& Proc) {
+			  if( Objects.empty() )
+			  {
+				  return;
+			  }
+			  JSON.Key(Key);
+			  JSON.BeginArray();
+			  for( const auto& CurObject : Objects )
+			  {
+				  JSON.BeginObject();
+				  Proc(CurObject);
+				  WriteExtensionsAndExtras(
+					  JSON, CurObject.extensions, CurObject.extras
+				  );
+				  JSON.EndObject();
+			  }
+			  JSON.EndArray();
+		  };
+
+	WriteArray("scenes", Model.scenes, [&](const tinygltf::Scene& Scene) {
+		WriteName(JSON, Scene.name);
+		WriteNumbers(JSON, "nodes", Scene.nodes);
+	});
+
+	WriteArray("nodes", Model.nodes, [&](const tinygltf::Node& Node) {
+		WriteName(JSON, Node.name);
+		WriteNumbers(JSON, "children", Node.children);
+		WriteIndex(JSON, "camera", Node.camera);
+		WriteIndex(JSON, "mesh", Node.mesh);
+		WriteIndex(JSON, "skin", Node.skin);
+		WriteNumbers(JSON, "matrix", Node.matrix);
+		WriteNumbers(JSON, "translation", Node.translation);
+		WriteNumbers(JSON, "rotation", Node.rotation);
+		WriteNumbers(JSON, "scale", Node.scale);
+		WriteNumbers(JSON, "weights", Node.weights);
+	});
+
+	WriteArray("meshes", Model.meshes, [&](const tinygltf::Mesh& Mesh) {
+		WriteName(JSON, Mesh.name);
+		WriteArray(
+			"primitives", Mesh.primitives,
+			[&](const tinygltf::Primitive& Primitive) {
+				JSON.Key("attributes");
+				JSON.BeginObject();
+				for( const auto& [Name, AccessorIdx] : Primitive.attributes )
+				{
+					JSON.Key(Name);
+					JSON.Integer(AccessorIdx);
+				}
+				JSON.EndObject();
+				WriteIndex(JSON, "indices", Primitive.indices);
+				WriteIndex(JSON, "material", Primitive.material);
+				WriteIndex(JSON, "mode", Primitive.mode);
+			}
+		);
+		WriteNumbers(JSON, "weights", Mesh.weights);
+	});
+
+	WriteArray(
+		"materials", Model.materials,
+		[&](const tinygltf::Material& Material) {
+			WriteName(JSON, Material.name);
+
+			const tinygltf::PbrMetallicRoughness& PBR
+				= Material.pbrMetallicRoughness;
+			JSON.Key("pbrMetallicRoughness");
+			JSON.BeginObject();
+			WriteNumbers(JSON, "baseColorFactor", PBR.baseColorFactor);
+			WriteTextureInfo(JSON, "baseColorTexture", PBR.baseColorTexture);
+			JSON.Key("metallicFactor");
+			JSON.Number(PBR.metallicFactor);
+			JSON.Key("roughnessFactor");
+			JSON.Number(PBR.roughnessFactor);
+			WriteTextureInfo(
+				JSON, "metallicRoughnessTexture", PBR.metallicRoughnessTexture
+			);
+			WriteExtensionsAndExtras(JSON, PBR.extensions, PBR.extras);
+			JSON.EndObject();
+
+			if( Material.alphaMode != "OPAQUE" )
+			{
+				JSON.Key("alphaMode");
+				JSON.String(Material.alphaMode);
+			}
+			if( Material.alphaMode == "MASK" )
+			{
+				JSON.Key("alphaCutoff");
+				JSON.Number(Material.alphaCutoff);
+			}
+			if( Material.doubleSided )
+			{
+				JSON.Key("doubleSided");
+				JSON.Bool(true);
+			}
+		}
+	);
+
+	WriteArray("skins", Model.skins, [&](const tinygltf::Skin& Skin) {
+		WriteName(JSON, Skin.name);
+		WriteIndex(JSON, "inverseBindMatrices", Skin.inverseBindMatrices);
+		WriteIndex(JSON, "skeleton", Skin.skeleton);
+		WriteNumbers(JSON, "joints", Skin.joints);
+	});
+
+	WriteArray("textures", Model.textures, [&](const tinygltf::Texture& Texture) {
+		WriteName(JSON, Texture.name);
+		WriteIndex(JSON, "sampler", Texture.sampler);
+		WriteIndex(JSON, "source", Texture.source);
+	});
+
+	WriteArray("images", Model.images, [&](const tinygltf::Image& Image) {
+		WriteName(JSON, Image.name);
+		if( !Image.uri.empty() )
+		{
+			JSON.Key("uri");
+			JSON.String(Image.uri);
+		}
+		WriteIndex(JSON, "bufferView", Image.bufferView);
+		if( !Image.mimeType.empty() )
+		{
+			JSON.Key("mimeType");
+			JSON.String(Image.mimeType);
+		}
+	});
+
+	WriteArray(
+		"accessors", Model.accessors,
+		[&](const tinygltf::Accessor& Accessor) {
+			WriteName(JSON, Accessor.name);
+			WriteIndex(JSON, "bufferView", Accessor.bufferView);
+			if( Accessor.byteOffset != 0 )
+			{
+				JSON.Key("byteOffset");
+				JSON.Integer(Accessor.byteOffset);
+			}
+			JSON.Key("componentType");
+			JSON.Integer(Accessor.componentType);
+			if( Accessor.normalized )
+			{
+				JSON.Key("normalized");
+				JSON.Bool(true);
+			}
+			JSON.Key("count");
+			JSON.Integer(Accessor.count);
+			JSON.Key("type");
+			JSON.String(AccessorTypeName(Accessor.type));
+			WriteNumbers(JSON, "min", Accessor.minValues);
+			WriteNumbers(JSON, "max", Accessor.maxValues);
+		}
+	);
+
+	WriteArray(
+		"bufferViews", Model.bufferViews,
+		[&](const tinygltf::BufferView& BufferView) {
+			WriteName(JSON, BufferView.name);
+			WriteIndex(JSON, "buffer", BufferView.buffer);
+			if( BufferView.byteOffset != 0 )
+			{
+				JSON.Key("byteOffset");
+				JSON.Integer(BufferView.byteOffset);
+			}
+			JSON.Key("byteLength");
+			JSON.Integer(BufferView.byteLength);
+			if( BufferView.byteStride != 0 )
+			{
+				JSON.Key("byteStride");
+				JSON.Integer(BufferView.byteStride);
+			}
+			if( BufferView.target != 0 )
+			{
+				JSON.Key("target");
+				JSON.Integer(BufferView.target);
+			}
+		}
+	);
+
+	WriteExtensionsAndExtras(JSON, Model.extensions, Model.extras);
+}
+
+void WriteU32(std::ostream& Stream, std::uint32_t Value)
+{
+	std::array<char, 4> Bytes;
+	std::memcpy(Bytes.data(), &Value, sizeof(Value));
+	Stream.write(Bytes.data(), Bytes.size());
+}
+
+constexpr std::size_t CopyChunkSize = 3 * 16 * 1024;
+
+void WritePayload(std::FILE* PayloadFile, const void* Data, std::size_t Size)
+{
+	if( std::fwrite(Data, 1, Size, PayloadFile) != Size )
+	{
+		throw std::runtime_error("Unable to write to temporary buffer file");
+	}
+}
+
+} // namespace
+
+GLTFWriter::GLTFWriter() : PayloadFile(std::tmpfile())
+{
+	if( PayloadFile == nullptr )
+	{
+		throw std::runtime_error("Unable to create temporary buffer file");
+	}
+}
+
+GLTFWriter::~GLTFWriter()
+{
+	std::fclose(PayloadFile);
+}
+
+std::size_t
+	GLTFWriter::Write(std::span<const std::byte> Data, std::size_t Alignment)
+{
+	static constexpr std::array<std::byte, 64> Padding = {};
+
+	const std::size_t Offset
+		= (PayloadSize + Alignment - 1) / Alignment * Alignment;
+	for( std::size_t PadSize = Offset - PayloadSize; PadSize != 0; )
+	{
+		const std::size_t CurPadSize = std::min(PadSize, Padding.size());
+		WritePayload(PayloadFile, Padding.data(), CurPadSize);
+		PadSize -= CurPadSize;
+	}
+
+	WritePayload(PayloadFile, Data.data(), Data.size());
+
+	PayloadSize = Offset + Data.size();
+	return Offset;
+}
+
+std::size_t GLTFWriter::GetSize() const
+{
+	return PayloadSize;
+}
+
+void GLTFWriter::Finish(
+	tinygltf::Model& Model, const std::filesystem::path& DestPath,
+	bool Binary, bool Pretty
+)
+{
+	std::string JSONPrefix;
+	std::string JSONSuffix;
+
+	JSONWriter JSON(JSONPrefix, Pretty);
+	JSON.BeginObject();
+	WriteModel(JSON, Model);
+
+	// The buffer is written last so that its base64 data may be streamed in
+	// between the prefix and suffix. Buffers may not be empty, so models
+	// without any data have none.
+	if( PayloadSize != 0 )
+	{
+		JSON.Key("buffers");
+		JSON.BeginArray();
+		JSON.BeginObject();
+		WriteName(JSON, Model.buffers[0].name);
+		JSON.Key("byteLength");
+		JSON.Integer(PayloadSize);
+		if( !Binary )
+		{
+			JSON.Key("uri");
+			JSON.BeginRawString();
+			JSONPrefix += "data:application/octet-stream;base64,";
+			JSON.SetOutput(JSONSuffix);
+			JSON.EndRawString();
+		}
+		JSON.EndObject();
+		JSON.EndArray();
+	}
+	JSON.EndObject();
+
+	std::ofstream OutFile(DestPath, std::ios::binary);
+	if( !OutFile )
+	{
+		throw std::runtime_error("Unable to open " + DestPath.string());
+	}
+
+	if( std::fflush(PayloadFile) != 0
+		|| std::fseek(PayloadFile, 0, SEEK_SET) != 0 )
+	{
+		throw std::runtime_error("Unable to read temporary buffer file");
+	}
+	std::vector<char> CopyBuffer(CopyChunkSize);
+
+	// Reads the next chunk of the payload, which must be read in full
+	std::size_t ReadTotal   = 0;
+	const auto  ReadPayload = [&]() {
+		const std::size_t ReadSize = std::fread(
+			CopyBuffer.data(), 1, CopyBuffer.size(), PayloadFile
+		);
+		ReadTotal += ReadSize;
+		if( std::ferror(PayloadFile)
+			|| (ReadSize == 0 && ReadTotal != PayloadSize) )
+		{
+			throw std::runtime_error("Unable to read temporary buffer file");
+		}
+		return ReadSize;
+	};
+
+	// Reports a failed write of the output, such as on a full disk
+	const auto CheckOutput = [&]() {
+		OutFile.close();
+		if( !OutFile )
+		{
+			throw std::runtime_error("Unable to write " + DestPath.string());
+		}
+	};
+
+	if( Binary )
+	{
+		// JSON chunk is padded with spaces, BIN chunk with zeros
+		const std::size_t JSONLength = (JSONPrefix.size() + 3) & ~std::size_t(3);
+		JSONPrefix.resize(JSONLength, ' ');
+		const std::size_t BINLength = (PayloadSize + 3) & ~std::size_t(3);
+
+		std::size_t TotalLength = 12 + 8 + JSONLength;
+		if( BINLength != 0 )
+		{
+			TotalLength += 8 + BINLength;
+		}
+
+		WriteU32(OutFile, 0x46546C67); // glTF
+		WriteU32(OutFile, 2);
+		WriteU32(OutFile, std::uint32_t(TotalLength));
+
+		WriteU32(OutFile, std::uint32_t(JSONLength));
+		WriteU32(OutFile, 0x4E4F534A); // JSON
+		OutFile.write(JSONPrefix.data(), JSONPrefix.size());
+
+		if( BINLength != 0 )
+		{
+			WriteU32(OutFile, std::uint32_t(BINLength));
+			WriteU32(OutFile, 0x004E4942); // BIN
+			while( const std::size_t ReadSize = ReadPayload() )
+			{
+				OutFile.write(CopyBuffer.data(), ReadSize);
+			}
+			OutFile.write("\0\0\0", BINLength - PayloadSize);
+		}
+		CheckOutput();
+		return;
+	}
+
+	OutFile.write(JSONPrefix.data(), JSONPrefix.size());
+
+	// Base64-encode the payload in chunks that are a multiple of three bytes
+	// so that no padding is emitted until the very end
+	static constexpr char Base64Chars[]
+		= "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string Encoded;
+	while( const std::size_t ReadSize = ReadPayload() )
+	{
+		Encoded.clear();
+		const auto* Bytes
+			= reinterpret_cast<const unsigned char*>(CopyBuffer.data());
+		for( std::size_t i = 0; i < ReadSize; i += 3 )
+		{
+			const std::size_t   Remaining = ReadSize - i;
+			const std::uint32_t Triple
+				= (std::uint32_t(Bytes[i]) << 16)
+				| (Remaining > 1 ? std::uint32_t(Bytes[i + 1]) << 8 : 0)
+				| (Remaining > 2 ? std::uint32_t(Bytes[i + 2]) : 0);
+
+			Encoded.push_back(Base64Chars[(Triple >> 18) & 0x3F]);
+			Encoded.push_back(Base64Chars[(Triple >> 12) & 0x3F]);
+			Encoded.push_back(
+				Remaining > 1 ? Base64Chars[(Triple >> 6) & 0x3F] : '='
+			);
+			Encoded.push_back(Remaining > 2 ? Base64Chars[Triple & 0x3F] : '=');
+		}
+		OutFile.write(Encoded.data(), Encoded.size());
+	}
+
+	OutFile.write(JSONSuffix.data(), JSONSuffix.size());
+	CheckOutput();
+}
+
+} // namespace TsuHan
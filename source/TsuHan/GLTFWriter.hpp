@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <span>
+
+#include "tiny_gltf.h"
+
+namespace TsuHan
+{
+
+// Streams the binary payload of a glTF model out as it is produced, so that
+// only the model's metadata is kept in memory. The payload is spooled to a
+// temporary file and assembled with the JSON into the final .gltf/.glb file
+// once the model is complete.
+class GLTFWriter
+{
+public:
+	GLTFWriter();
+	~GLTFWriter();
+
+	GLTFWriter(const GLTFWriter&)            = delete;
+	GLTFWriter& operator=(const GLTFWriter&) = delete;
+
+	// Appends `Data` to the model's buffer and returns its byte-offset
+	std::size_t Write(std::span<const std::byte> Data, std::size_t Alignment);
+
+	std::size_t GetSize() const;
+
+	// Writes the model along with all the data that has been written to its
+	// buffer. `Model` must contain a single, empty, buffer.
+	void Finish(
+		tinygltf::Model& Model, const std::filesystem::path& DestPath,
+		bool Binary, bool Pretty
+	);
+
+private:
+	std::FILE*  PayloadFile = nullptr;
+	std::size_t PayloadSize = 0;
+};
+
+} // namespace TsuHan
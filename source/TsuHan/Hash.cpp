@@ -0,0 +1,140 @@
+#include "Hash.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)                                     \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSUHAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// The data is consumed in blocks of four 64-bit lanes. Each lane is keyed and
+// multiplied by itself, 32 by 32 bits, and its neighbour accumulates the lane
+// as-is, after the accumulation of XXH3.
+constexpr std::size_t BlockSize = 32;
+
+constexpr std::array<std::uint64_t, 4> LaneKeys = {
+	0xBE4BA423396CFEB8ULL,
+	0x1CAD21F72C81017CULL,
+	0xDB979083E96DD4DEULL,
+	0x1F67B3B7A4A44072ULL,
+};
+
+constexpr std::array<std::uint64_t, 4> LaneSeeds = {
+	0x9E3779B185EBCA87ULL,
+	0xC2B2AE3D27D4EB4FULL,
+	0x165667B19E3779F9ULL,
+	0x85EBCA77C2B2AE63ULL,
+};
+
+void AccumulateBlock(
+	std::array<std::uint64_t, 4>& Acc, const std::byte* Block
+)
+{
+	std::array<std::uint64_t, 4> Lanes;
+	std::memcpy(Lanes.data(), Block, BlockSize);
+
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		const std::uint64_t KeyedLane = Lanes[i] ^ LaneKeys[i];
+		Acc[i ^ 1] += Lanes[i];
+		Acc[i] += (KeyedLane & 0xFFFFFFFFU) * (KeyedLane >> 32);
+	}
+}
+
+std::uint64_t Avalanche(std::uint64_t Hash)
+{
+	Hash ^= Hash >> 30;
+	Hash *= 0xBF58476D1CE4E5B9ULL;
+	Hash ^= Hash >> 27;
+	Hash *= 0x94D049BB133111EBULL;
+	Hash ^= Hash >> 31;
+	return Hash;
+}
+
+#if defined(TSUHAN_SSE2)
+
+// Accumulates all whole blocks and returns the amount of bytes consumed
+std::size_t AccumulateSSE2(
+	std::array<std::uint64_t, 4>& Acc, std::span<const std::byte> Data
+)
+{
+	__m128i AccLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&Acc[0]));
+	__m128i AccHi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&Acc[2]));
+
+	const __m128i KeyLo
+		= _mm_loadu_si128(reinterpret_cast<const __m128i*>(&LaneKeys[0]));
+	const __m128i KeyHi
+		= _mm_loadu_si128(reinterpret_cast<const __m128i*>(&LaneKeys[2]));
+
+	const auto Accumulate = [](__m128i CurAcc, __m128i Lanes, __m128i Key) {
+		const __m128i KeyedLanes = _mm_xor_si128(Lanes, Key);
+		// Upper half of each lane, multiplied by its lower half
+		const __m128i Product = _mm_mul_epu32(
+			KeyedLanes, _mm_shuffle_epi32(KeyedLanes, _MM_SHUFFLE(3, 3, 1, 1))
+		);
+		// Each lane goes to its neighbour
+		const __m128i Swapped
+			= _mm_shuffle_epi32(Lanes, _MM_SHUFFLE(1, 0, 3, 2));
+		return _mm_add_epi64(CurAcc, _mm_add_epi64(Swapped, Product));
+	};
+
+	const std::size_t BlockCount = Data.size() / BlockSize;
+	for( std::size_t i = 0; i < BlockCount; ++i )
+	{
+		const auto* CurBlock
+			= reinterpret_cast<const __m128i*>(Data.data() + i * BlockSize);
+		AccLo = Accumulate(AccLo, _mm_loadu_si128(CurBlock + 0), KeyLo);
+		AccHi = Accumulate(AccHi, _mm_loadu_si128(CurBlock + 1), KeyHi);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(&Acc[0]), AccLo);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(&Acc[2]), AccHi);
+
+	return BlockCount * BlockSize;
+}
+
+#endif
+
+} // namespace
+
+std::uint64_t HashBytes(std::span<const std::byte> Data)
+{
+	std::array<std::uint64_t, 4> Acc = LaneSeeds;
+
+	std::size_t Offset = 0;
+#if defined(TSUHAN_SSE2)
+	Offset = AccumulateSSE2(Acc, Data);
+#endif
+	for( ; Offset + BlockSize <= Data.size(); Offset += BlockSize )
+	{
+		AccumulateBlock(Acc, Data.data() + Offset);
+	}
+
+	// The last partial block is padded with zeros, which the size of the data
+	// tells apart from actual zeros
+	if( Offset < Data.size() )
+	{
+		std::array<std::byte, BlockSize> LastBlock = {};
+		std::memcpy(
+			LastBlock.data(), Data.data() + Offset, Data.size() - Offset
+		);
+		AccumulateBlock(Acc, LastBlock.data());
+	}
+
+	std::uint64_t Hash = Data.size() * 0x9E3779B97F4A7C15ULL;
+	for( const std::uint64_t CurAcc : Acc )
+	{
+		Hash = Avalanche(Hash ^ CurAcc);
+	}
+	return Hash;
+}
+
+} // namespace TsuHan
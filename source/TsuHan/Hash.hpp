@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace TsuHan
+{
+
+// Fast non-cryptographic 64-bit hash, for telling apart the contents of
+// files. The scalar and SSE2 paths produce the same hash.
+std::uint64_t HashBytes(std::span<const std::byte> Data);
+
+} // namespace TsuHan
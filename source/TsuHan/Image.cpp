@@ -0,0 +1,784 @@
+#include "Image.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "Deflate.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)                                     \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSUHAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace TsuHan
+{
+
+namespace
+{
+
+constexpr std::size_t TGAHeaderSize = 18;
+
+// Image types, to which run-length encoding adds 8
+constexpr std::uint8_t TGAColorMapped = 1;
+constexpr std::uint8_t TGATrueColor   = 2;
+constexpr std::uint8_t TGAGrayscale   = 3;
+constexpr std::uint8_t TGARunLength   = 8;
+
+// Descriptor bits
+constexpr std::uint8_t TGAAlphaBitsMask  = 0x0F;
+constexpr std::uint8_t TGARightToLeft    = 0x10;
+constexpr std::uint8_t TGATopToBottom    = 0x20;
+constexpr std::size_t  TGAMaxPacketCount = 128;
+
+// Consumes the bytes of a file, throwing if there are not enough
+class ByteReader
+{
+	std::span<const std::byte> Data;
+
+public:
+	explicit ByteReader(std::span<const std::byte> Source) : Data(Source)
+	{
+	}
+
+	std::span<const std::byte> Read(std::size_t Count)
+	{
+		if( Count > Data.size() )
+		{
+			throw std::out_of_range("TGA data exceeds file size");
+		}
+		const std::span<const std::byte> Result = Data.first(Count);
+		Data                                    = Data.subspan(Count);
+		return Result;
+	}
+
+	std::size_t GetRemaining() const
+	{
+		return Data.size();
+	}
+};
+
+std::uint8_t ReadU8(const std::byte* Source)
+{
+	return std::to_integer<std::uint8_t>(Source[0]);
+}
+
+std::uint16_t ReadU16(const std::byte* Source)
+{
+	return ReadU8(Source) | (ReadU8(Source + 1) << 8);
+}
+
+// Converts a true-color or grayscale pixel of `Depth` bits into `Channels`
+// bytes. True-color pixels are stored as BGR(A), with 15/16-bit pixels
+// packed as 5-5-5 and an attribute bit.
+void ConvertPixel(
+	const std::byte* Source, std::size_t Depth, bool Grayscale,
+	std::byte* Dest, std::size_t Channels
+)
+{
+	if( Grayscale )
+	{
+		std::copy_n(Source, Channels, Dest);
+		return;
+	}
+
+	if( Depth <= 16 )
+	{
+		const std::uint16_t Packed = ReadU16(Source);
+
+		const auto Expand = [](std::uint16_t Value) {
+			Value &= 0b11111;
+			return static_cast<std::byte>((Value << 3) | (Value >> 2));
+		};
+		Dest[0] = Expand(Packed >> 10);
+		Dest[1] = Expand(Packed >> 5);
+		Dest[2] = Expand(Packed);
+		if( Channels == 4 )
+		{
+			Dest[3] = (Packed & 0x8000) ? std::byte{0xFF} : std::byte{0x00};
+		}
+		return;
+	}
+
+	Dest[0] = Source[2];
+	Dest[1] = Source[1];
+	Dest[2] = Source[0];
+	if( Channels == 4 )
+	{
+		Dest[3] = Source[3];
+	}
+}
+
+std::uint8_t PaethPredictor(std::uint8_t A, std::uint8_t B, std::uint8_t C)
+{
+	const int Estimate = int(A) + int(B) - int(C);
+	const int DistA    = std::abs(Estimate - int(A));
+	const int DistB    = std::abs(Estimate - int(B));
+	const int DistC    = std::abs(Estimate - int(C));
+	if( DistA <= DistB && DistA <= DistC )
+	{
+		return A;
+	}
+	return DistB <= DistC ? B : C;
+}
+
+void WriteU32BE(std::vector<std::byte>& Out, std::uint32_t Value)
+{
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Out.push_back(static_cast<std::byte>(Value >> (24 - i * 8)));
+	}
+}
+
+void WritePNGChunk(
+	std::vector<std::byte>& Out, const char (&Type)[5],
+	std::span<const std::byte> Data
+)
+{
+	WriteU32BE(Out, static_cast<std::uint32_t>(Data.size()));
+
+	const std::size_t TypeOffset = Out.size();
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Out.push_back(static_cast<std::byte>(Type[i]));
+	}
+	Out.insert(Out.end(), Data.begin(), Data.end());
+
+	// Covers the type and the data
+	WriteU32BE(Out, CRC32(std::span(Out).subspan(TypeOffset)));
+}
+
+// Kaiser window of the mip filter, over a radius of destination pixels
+constexpr float       KaiserAlpha  = 4.0f;
+constexpr float       KaiserRadius = 2.0f;
+constexpr std::size_t KaiserTaps   = 8; // Source pixels within the radius
+
+// Modified Bessel function of the first kind, of order 0
+float BesselI0(float X)
+{
+	float Sum  = 1.0f;
+	float Term = 1.0f;
+	for( std::size_t k = 1; k < 16; ++k )
+	{
+		Term *= (X / (2.0f * k)) * (X / (2.0f * k));
+		Sum += Term;
+	}
+	return Sum;
+}
+
+// Weights of the source pixels of a destination pixel, starting three
+// pixels before its first source pixel. They are the same for every
+// destination pixel.
+std::array<float, KaiserTaps> GetKaiserWeights()
+{
+	constexpr float Pi = 3.14159265358979f;
+
+	std::array<float, KaiserTaps> Result;
+	float                         Sum = 0.0f;
+	for( std::size_t i = 0; i < KaiserTaps; ++i )
+	{
+		// Distance between the centers, in destination pixels
+		const float Distance
+			= (float(i) - (KaiserTaps / 2.0f - 0.5f)) * 0.5f;
+		const float Sinc
+			= Distance == 0.0f
+				? 1.0f
+				: std::sin(Pi * Distance) / (Pi * Distance);
+		const float Ratio = Distance / KaiserRadius;
+		const float Window
+			= BesselI0(KaiserAlpha * std::sqrt(1.0f - Ratio * Ratio))
+			/ BesselI0(KaiserAlpha);
+		Result[i] = Sinc * Window;
+		Sum += Result[i];
+	}
+	for( float& CurWeight : Result )
+	{
+		CurWeight /= Sum;
+	}
+	return Result;
+}
+
+// Averages each 2x2 quad, with the last row and column repeated for odd
+// sizes
+void DownsampleBox(const Bitmap& Image, Bitmap& Result)
+{
+	const std::size_t SourceStride = std::size_t(Image.Width) * 4;
+	const std::size_t DestStride   = std::size_t(Result.Width) * 4;
+
+	const auto* Source
+		= reinterpret_cast<const std::uint8_t*>(Image.Pixels.data());
+	auto* Dest = reinterpret_cast<std::uint8_t*>(Result.Pixels.data());
+
+	for( std::size_t y = 0; y < Result.Height; ++y )
+	{
+		const std::uint8_t* Row0 = Source + (2 * y) * SourceStride;
+		const std::uint8_t* Row1
+			= Source
+			+ std::min<std::size_t>(2 * y + 1, Image.Height - 1) * SourceStride;
+		std::uint8_t* DestRow = Dest + y * DestStride;
+
+		std::size_t x = 0;
+#if defined(TSUHAN_SSE2)
+		// Two destination pixels from four source pixels of each row
+		const __m128i Zero     = _mm_setzero_si128();
+		const __m128i Rounding = _mm_set1_epi16(2);
+		for( ; 2 * x + 4 <= Image.Width; x += 2 )
+		{
+			const __m128i A = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(Row0 + x * 8)
+			);
+			const __m128i B = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(Row1 + x * 8)
+			);
+			const __m128i SumLo = _mm_add_epi16(
+				_mm_unpacklo_epi8(A, Zero), _mm_unpacklo_epi8(B, Zero)
+			);
+			const __m128i SumHi = _mm_add_epi16(
+				_mm_unpackhi_epi8(A, Zero), _mm_unpackhi_epi8(B, Zero)
+			);
+			// Adds the right pixel of each pair onto the left one
+			const __m128i Pixel0
+				= _mm_add_epi16(SumLo, _mm_srli_si128(SumLo, 8));
+			const __m128i Pixel1
+				= _mm_add_epi16(SumHi, _mm_srli_si128(SumHi, 8));
+			const __m128i Average = _mm_srli_epi16(
+				_mm_add_epi16(_mm_unpacklo_epi64(Pixel0, Pixel1), Rounding), 2
+			);
+			_mm_storel_epi64(
+				reinterpret_cast<__m128i*>(DestRow + x * 4),
+				_mm_packus_epi16(Average, Zero)
+			);
+		}
+#endif
+		for( ; x < Result.Width; ++x )
+		{
+			const std::size_t X0 = 2 * x * 4;
+			const std::size_t X1
+				= std::min<std::size_t>(2 * x + 1, Image.Width - 1) * 4;
+			for( std::size_t c = 0; c < 4; ++c )
+			{
+				DestRow[x * 4 + c] = static_cast<std::uint8_t>(
+					(Row0[X0 + c] + Row0[X1 + c] + Row1[X0 + c] + Row1[X1 + c]
+					 + 2)
+					>> 2
+				);
+			}
+		}
+	}
+}
+
+// Filters the rows and then the columns, with the edges clamped
+void DownsampleKaiser(const Bitmap& Image, Bitmap& Result)
+{
+	static const std::array<float, KaiserTaps> Weights = GetKaiserWeights();
+	constexpr std::ptrdiff_t FirstTap = -std::ptrdiff_t(KaiserTaps / 2 - 1);
+
+	const auto* Source
+		= reinterpret_cast<const std::uint8_t*>(Image.Pixels.data());
+
+	// Source rows filtered horizontally
+	std::vector<float> Rows(std::size_t(Result.Width) * Image.Height * 4);
+	for( std::size_t y = 0; y < Image.Height; ++y )
+	{
+		const std::uint8_t* SourceRow = Source + y * Image.Width * 4;
+		float* CurRow = Rows.data() + y * Result.Width * 4;
+		for( std::size_t x = 0; x < Result.Width; ++x )
+		{
+			std::array<float, 4> Sum = {};
+			for( std::size_t i = 0; i < KaiserTaps; ++i )
+			{
+				const std::size_t SourceX = std::clamp<std::ptrdiff_t>(
+					2 * x + FirstTap + i, 0, Image.Width - 1
+				);
+				for( std::size_t c = 0; c < 4; ++c )
+				{
+					Sum[c] += Weights[i] * SourceRow[SourceX * 4 + c];
+				}
+			}
+			std::copy(Sum.begin(), Sum.end(), CurRow + x * 4);
+		}
+	}
+
+	auto* Dest = reinterpret_cast<std::uint8_t*>(Result.Pixels.data());
+	const std::size_t RowSize = std::size_t(Result.Width) * 4;
+	for( std::size_t y = 0; y < Result.Height; ++y )
+	{
+		std::vector<float> Sum(RowSize, 0.0f);
+		for( std::size_t i = 0; i < KaiserTaps; ++i )
+		{
+			const std::size_t SourceY = std::clamp<std::ptrdiff_t>(
+				2 * y + FirstTap + i, 0, Image.Height - 1
+			);
+			const float* CurRow = Rows.data() + SourceY * RowSize;
+			for( std::size_t j = 0; j < RowSize; ++j )
+			{
+				Sum[j] += Weights[i] * CurRow[j];
+			}
+		}
+		for( std::size_t j = 0; j < RowSize; ++j )
+		{
+			Dest[y * RowSize + j] = static_cast<std::uint8_t>(
+				std::clamp(std::lround(Sum[j]), 0L, 255L)
+			);
+		}
+	}
+}
+
+} // namespace
+
+Bitmap DecodeTGA(std::span<const std::byte> Data)
+{
+	ByteReader Reader(Data);
+
+	const std::byte*    Header         = Reader.Read(TGAHeaderSize).data();
+	const std::uint8_t  IDLength       = ReadU8(Header + 0);
+	const std::uint8_t  ColorMapType   = ReadU8(Header + 1);
+	const std::uint8_t  ImageType      = ReadU8(Header + 2);
+	const std::uint16_t ColorMapFirst  = ReadU16(Header + 3);
+	const std::uint16_t ColorMapLength = ReadU16(Header + 5);
+	const std::uint8_t  ColorMapDepth  = ReadU8(Header + 7);
+	const std::uint16_t Width          = ReadU16(Header + 12);
+	const std::uint16_t Height         = ReadU16(Header + 14);
+	const std::uint8_t  PixelDepth     = ReadU8(Header + 16);
+	const std::uint8_t  Descriptor     = ReadU8(Header + 17);
+
+	const std::uint8_t BaseType  = ImageType & ~TGARunLength;
+	const bool         RunLength = ImageType & TGARunLength;
+
+	const auto IsColorDepth = [](std::uint8_t Depth) {
+		return Depth == 15 || Depth == 16 || Depth == 24 || Depth == 32;
+	};
+
+	// Depth of the colors, which is that of the color map for color-mapped
+	// images
+	std::uint8_t ColorDepth = PixelDepth;
+	switch( BaseType )
+	{
+	case TGAColorMapped:
+	{
+		if( ColorMapType != 1 || (PixelDepth != 8 && PixelDepth != 16)
+			|| !IsColorDepth(ColorMapDepth) )
+		{
+			throw std::runtime_error("Unsupported TGA color map");
+		}
+		ColorDepth = ColorMapDepth;
+		break;
+	}
+	case TGATrueColor:
+	{
+		if( !IsColorDepth(PixelDepth) )
+		{
+			throw std::runtime_error("Unsupported TGA pixel depth");
+		}
+		break;
+	}
+	case TGAGrayscale:
+	{
+		if( PixelDepth != 8 && PixelDepth != 16 )
+		{
+			throw std::runtime_error("Unsupported TGA pixel depth");
+		}
+		break;
+	}
+	default:
+	{
+		throw std::runtime_error("Unsupported TGA image type");
+	}
+	}
+
+	const bool Grayscale = BaseType == TGAGrayscale;
+
+	Bitmap Result;
+	Result.Width  = Width;
+	Result.Height = Height;
+	if( Grayscale )
+	{
+		Result.Channels = PixelDepth == 16 ? 2 : 1;
+	}
+	else
+	{
+		const bool HasAlpha
+			= ColorDepth == 32
+		   || (ColorDepth == 16 && (Descriptor & TGAAlphaBitsMask));
+		Result.Channels = HasAlpha ? 4 : 3;
+	}
+
+	Reader.Read(IDLength);
+
+	// Colors of the color map, converted up-front
+	std::vector<std::byte> Palette;
+	if( ColorMapType == 1 )
+	{
+		const std::size_t EntrySize = (ColorMapDepth + 7) / 8;
+		const std::span<const std::byte> ColorMap
+			= Reader.Read(ColorMapLength * EntrySize);
+		if( BaseType == TGAColorMapped )
+		{
+			Palette.resize(ColorMapLength * Result.Channels);
+			for( std::size_t i = 0; i < ColorMapLength; ++i )
+			{
+				ConvertPixel(
+					ColorMap.data() + i * EntrySize, ColorMapDepth, false,
+					Palette.data() + i * Result.Channels, Result.Channels
+				);
+			}
+		}
+	}
+
+	const std::size_t PixelSize  = (PixelDepth + 7) / 8;
+	const std::size_t PixelCount = std::size_t(Width) * Height;
+
+	// Each packet holds at most 128 pixels in at least one byte
+	if( RunLength
+		&& PixelCount > Reader.GetRemaining() * TGAMaxPacketCount )
+	{
+		throw std::out_of_range("TGA data exceeds file size");
+	}
+
+	Result.Pixels.resize(PixelCount * Result.Channels);
+	std::byte* CurPixel = Result.Pixels.data();
+
+	const auto DecodePixel = [&](const std::byte* Source) {
+		if( BaseType == TGAColorMapped )
+		{
+			const std::size_t Index
+				= (PixelSize == 1 ? ReadU8(Source) : ReadU16(Source))
+				- ColorMapFirst;
+			if( Index >= ColorMapLength )
+			{
+				throw std::out_of_range("TGA color index exceeds color map");
+			}
+			std::copy_n(
+				Palette.data() + Index * Result.Channels, Result.Channels,
+				CurPixel
+			);
+		}
+		else
+		{
+			ConvertPixel(
+				Source, PixelDepth, Grayscale, CurPixel, Result.Channels
+			);
+		}
+		CurPixel += Result.Channels;
+	};
+
+	if( !RunLength )
+	{
+		const std::span<const std::byte> PixelData
+			= Reader.Read(PixelCount * PixelSize);
+		for( std::size_t i = 0; i < PixelCount; ++i )
+		{
+			DecodePixel(PixelData.data() + i * PixelSize);
+		}
+	}
+	else
+	{
+		// Packets are either a single pixel repeated, or raw pixels. They may
+		// span several rows.
+		for( std::size_t i = 0; i < PixelCount; )
+		{
+			const std::uint8_t PacketHeader = ReadU8(Reader.Read(1).data());
+			const std::size_t  PacketCount  = std::min<std::size_t>(
+				(PacketHeader & 0x7F) + 1, PixelCount - i
+			);
+
+			if( PacketHeader & 0x80 )
+			{
+				const std::byte* RunPixel = CurPixel;
+				DecodePixel(Reader.Read(PixelSize).data());
+				for( std::size_t j = 1; j < PacketCount; ++j )
+				{
+					CurPixel = std::copy_n(RunPixel, Result.Channels, CurPixel);
+				}
+			}
+			else
+			{
+				const std::span<const std::byte> PacketData
+					= Reader.Read(PacketCount * PixelSize);
+				for( std::size_t j = 0; j < PacketCount; ++j )
+				{
+					DecodePixel(PacketData.data() + j * PixelSize);
+				}
+			}
+			i += PacketCount;
+		}
+	}
+
+	// Rows are stored bottom-up unless told otherwise
+	const std::size_t RowSize = std::size_t(Width) * Result.Channels;
+	if( !(Descriptor & TGATopToBottom) )
+	{
+		for( std::size_t Row = 0; Row < Height / 2; ++Row )
+		{
+			std::swap_ranges(
+				Result.Pixels.begin() + Row * RowSize,
+				Result.Pixels.begin() + (Row + 1) * RowSize,
+				Result.Pixels.begin() + (Height - 1 - Row) * RowSize
+			);
+		}
+	}
+	if( Descriptor & TGARightToLeft )
+	{
+		for( std::size_t Row = 0; Row < Height; ++Row )
+		{
+			std::byte* CurRow = Result.Pixels.data() + Row * RowSize;
+			for( std::size_t Column = 0; Column < Width / 2; ++Column )
+			{
+				std::swap_ranges(
+					CurRow + Column * Result.Channels,
+					CurRow + (Column + 1) * Result.Channels,
+					CurRow + (Width - 1 - Column) * Result.Channels
+				);
+			}
+		}
+	}
+
+	return Result;
+}
+
+std::pair<std::uint32_t, std::uint32_t>
+	GetTGASize(std::span<const std::byte> Data)
+{
+	ByteReader Reader(Data);
+
+	const std::byte* Header = Reader.Read(TGAHeaderSize).data();
+	return {ReadU16(Header + 12), ReadU16(Header + 14)};
+}
+
+Bitmap ToRGBA(const Bitmap& Image)
+{
+	if( Image.Channels == 4 )
+	{
+		return Image;
+	}
+
+	Bitmap Result;
+	Result.Width    = Image.Width;
+	Result.Height   = Image.Height;
+	Result.Channels = 4;
+
+	const std::size_t PixelCount = std::size_t(Image.Width) * Image.Height;
+	Result.Pixels.resize(PixelCount * 4);
+	for( std::size_t i = 0; i < PixelCount; ++i )
+	{
+		const std::byte* Source = Image.Pixels.data() + i * Image.Channels;
+		std::byte*       Dest   = Result.Pixels.data() + i * 4;
+		if( Image.Channels <= 2 )
+		{
+			Dest[0] = Dest[1] = Dest[2] = Source[0];
+		}
+		else
+		{
+			std::copy_n(Source, 3, Dest);
+		}
+		Dest[3] = Image.Channels == 2 ? Source[1] : std::byte{0xFF};
+	}
+	return Result;
+}
+
+AlphaCoverage ClassifyAlpha(const Bitmap& Image)
+{
+	if( Image.Channels != 2 && Image.Channels != 4 )
+	{
+		return AlphaCoverage::Opaque;
+	}
+
+	const auto* Pixels
+		= reinterpret_cast<const std::uint8_t*>(Image.Pixels.data());
+	const std::size_t Size = Image.Pixels.size();
+
+	// Any alpha other than 255, and any other than both 0 and 255
+	bool NotOpaque = false;
+	bool NotBinary = false;
+
+	std::size_t i = 0;
+#if defined(TSUHAN_SSE2)
+	// Pixels fit evenly into 16 bytes, with their alpha as their last byte.
+	// Other bytes are masked to 0, which makes them pass both tests.
+	const __m128i AlphaMask = Image.Channels == 4
+								? _mm_set1_epi32(std::int32_t(0xFF000000))
+								: _mm_set1_epi16(std::int16_t(0xFF00));
+	const __m128i Zero      = _mm_setzero_si128();
+	const __m128i Ones      = _mm_set1_epi8(-1);
+
+	// Translucency is checked for once per span, so that the inner loop
+	// does not branch on it
+	constexpr std::size_t SpanSize   = 4096;
+	const std::size_t     VectorSize = Size - Size % 16;
+	while( i < VectorSize && !NotBinary )
+	{
+		const std::size_t SpanEnd = std::min(VectorSize, i + SpanSize);
+
+		__m128i NotFull   = Zero;
+		__m128i NotZeroFF = Zero;
+		for( ; i < SpanEnd; i += 16 )
+		{
+			const __m128i Alpha = _mm_and_si128(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(Pixels + i)),
+				AlphaMask
+			);
+			const __m128i IsFull = _mm_cmpeq_epi8(Alpha, AlphaMask);
+			const __m128i IsZero = _mm_cmpeq_epi8(Alpha, Zero);
+			NotFull = _mm_or_si128(NotFull, _mm_andnot_si128(IsFull, Ones));
+			NotZeroFF = _mm_or_si128(
+				NotZeroFF, _mm_andnot_si128(_mm_or_si128(IsFull, IsZero), Ones)
+			);
+		}
+		NotOpaque |= _mm_movemask_epi8(NotFull) != 0;
+		NotBinary |= _mm_movemask_epi8(NotZeroFF) != 0;
+	}
+	if( NotBinary )
+	{
+		return AlphaCoverage::Translucent;
+	}
+#endif
+	for( ; i < Size; i += Image.Channels )
+	{
+		const std::uint8_t Alpha = Pixels[i + Image.Channels - 1];
+		NotOpaque |= Alpha != 0xFF;
+		NotBinary |= Alpha != 0xFF && Alpha != 0;
+	}
+
+	if( NotBinary )
+	{
+		return AlphaCoverage::Translucent;
+	}
+	return NotOpaque ? AlphaCoverage::Cutout : AlphaCoverage::Opaque;
+}
+
+Bitmap Downsample(const Bitmap& Image, MipFilter Filter)
+{
+	if( Image.Channels != 4 )
+	{
+		throw std::invalid_argument("Mip levels need an RGBA image");
+	}
+
+	Bitmap Result;
+	Result.Width    = std::max<std::uint32_t>(Image.Width / 2, 1);
+	Result.Height   = std::max<std::uint32_t>(Image.Height / 2, 1);
+	Result.Channels = 4;
+	Result.Pixels.resize(std::size_t(Result.Width) * Result.Height * 4);
+
+	switch( Filter )
+	{
+	case MipFilter::Box:
+	{
+		DownsampleBox(Image, Result);
+		break;
+	}
+	case MipFilter::Kaiser:
+	{
+		DownsampleKaiser(Image, Result);
+		break;
+	}
+	}
+	return Result;
+}
+
+std::vector<std::byte> EncodePNG(const Bitmap& Image)
+{
+	// Color type of each channel count
+	constexpr std::array<std::uint8_t, 5> ColorTypes = {0, 0, 4, 2, 6};
+
+	// Filter types
+	constexpr std::size_t FilterCount = 5;
+	constexpr std::size_t FilterNone  = 0;
+	constexpr std::size_t FilterSub   = 1;
+	constexpr std::size_t FilterUp    = 2;
+	constexpr std::size_t FilterAvg   = 3;
+	constexpr std::size_t FilterPaeth = 4;
+
+	if( Image.Channels == 0 || Image.Channels > 4 )
+	{
+		throw std::invalid_argument("Unsupported PNG channel count");
+	}
+
+	const std::size_t RowSize   = std::size_t(Image.Width) * Image.Channels;
+	const std::size_t PixelSize = Image.Channels;
+
+	// Each row is prefixed with the filter that it was filtered with. The
+	// filter whose output has the smallest sum of absolute values is picked,
+	// as it tends to compress best.
+	std::vector<std::byte> Filtered((RowSize + 1) * Image.Height);
+	std::array<std::vector<std::uint8_t>, FilterCount> Candidates;
+	for( auto& CurCandidate : Candidates )
+	{
+		CurCandidate.resize(RowSize);
+	}
+	const std::vector<std::uint8_t> ZeroRow(RowSize, 0);
+
+	for( std::size_t Row = 0; Row < Image.Height; ++Row )
+	{
+		const auto* CurRow = reinterpret_cast<const std::uint8_t*>(
+			Image.Pixels.data() + Row * RowSize
+		);
+		const std::uint8_t* PrevRow
+			= Row ? CurRow - RowSize : ZeroRow.data();
+
+		for( std::size_t i = 0; i < RowSize; ++i )
+		{
+			const bool         HasLeft = i >= PixelSize;
+			const std::uint8_t Left    = HasLeft ? CurRow[i - PixelSize] : 0;
+			const std::uint8_t Up      = PrevRow[i];
+			const std::uint8_t UpLeft  = HasLeft ? PrevRow[i - PixelSize] : 0;
+
+			Candidates[FilterNone][i]  = CurRow[i];
+			Candidates[FilterSub][i]   = CurRow[i] - Left;
+			Candidates[FilterUp][i]    = CurRow[i] - Up;
+			Candidates[FilterAvg][i]   = CurRow[i] - (Left + Up) / 2;
+			Candidates[FilterPaeth][i]
+				= CurRow[i] - PaethPredictor(Left, Up, UpLeft);
+		}
+
+		std::size_t BestFilter = 0;
+		std::size_t BestScore  = std::numeric_limits<std::size_t>::max();
+		for( std::size_t CurFilter = 0; CurFilter < FilterCount; ++CurFilter )
+		{
+			std::size_t Score = 0;
+			for( const std::uint8_t CurByte : Candidates[CurFilter] )
+			{
+				Score += std::abs(static_cast<std::int8_t>(CurByte));
+			}
+			if( Score < BestScore )
+			{
+				BestFilter = CurFilter;
+				BestScore  = Score;
+			}
+		}
+
+		std::byte* FilteredRow = Filtered.data() + Row * (RowSize + 1);
+		FilteredRow[0]         = static_cast<std::byte>(BestFilter);
+		std::memcpy(FilteredRow + 1, Candidates[BestFilter].data(), RowSize);
+	}
+
+	std::vector<std::byte> Result;
+
+	constexpr std::array<std::uint8_t, 8> Signature
+		= {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	for( const std::uint8_t CurByte : Signature )
+	{
+		Result.push_back(static_cast<std::byte>(CurByte));
+	}
+
+	std::vector<std::byte> ImageHeader;
+	WriteU32BE(ImageHeader, Image.Width);
+	WriteU32BE(ImageHeader, Image.Height);
+	ImageHeader.push_back(std::byte{8}); // Bit depth
+	ImageHeader.push_back(static_cast<std::byte>(ColorTypes[Image.Channels]));
+	ImageHeader.push_back(std::byte{0}); // Deflate
+	ImageHeader.push_back(std::byte{0}); // Adaptive filtering
+	ImageHeader.push_back(std::byte{0}); // Not interlaced
+	WritePNGChunk(Result, "IHDR", ImageHeader);
+
+	WritePNGChunk(Result, "IDAT", ZlibCompress(Filtered));
+	WritePNGChunk(Result, "IEND", {});
+
+	return Result;
+}
+
+} // namespace TsuHan
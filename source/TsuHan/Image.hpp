@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <TsuHan/TextureCache.hpp>
+
+namespace TsuHan
+{
+
+// 8-bit pixels, top row first. One channel is gray, two are gray and alpha,
+// three are RGB and four are RGBA.
+struct Bitmap
+{
+	std::uint32_t          Width    = 0;
+	std::uint32_t          Height   = 0;
+	std::uint8_t           Channels = 0;
+	std::vector<std::byte> Pixels;
+};
+
+// Decodes a color-mapped, true-color or grayscale TGA image, either raw or
+// run-length encoded. Images with an alpha channel keep it.
+Bitmap DecodeTGA(std::span<const std::byte> Data);
+
+// Width and height of a TGA image, read from its header alone
+std::pair<std::uint32_t, std::uint32_t>
+	GetTGASize(std::span<const std::byte> Data);
+
+// The image with four channels, with gray spread over RGB and opaque alpha
+// added where there is none
+Bitmap ToRGBA(const Bitmap& Image);
+
+// Scans the alpha of an image, if it has any
+AlphaCoverage ClassifyAlpha(const Bitmap& Image);
+
+enum class MipFilter
+{
+	Box,    // Average of each 2x2 quad
+	Kaiser, // Kaiser-windowed sinc, which keeps more detail
+};
+
+// Next mip level of an RGBA image: half its size, rounded down to at least
+// one pixel
+Bitmap Downsample(const Bitmap& Image, MipFilter Filter);
+
+// Encodes an image as a PNG, choosing the filter of each row that is likely
+// to compress best
+std::vector<std::byte> EncodePNG(const Bitmap& Image);
+
+} // namespace TsuHan
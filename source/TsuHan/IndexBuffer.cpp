@@ -0,0 +1,450 @@
+#include "IndexBuffer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// Tuning of the vertex scores, as given in the paper
+constexpr std::size_t OptimizeCacheSize = 32;
+constexpr float       CacheDecayPower   = 1.5f;
+constexpr float       LastTriangleScore = 0.75f;
+constexpr float       ValenceBoostScale = 2.0f;
+constexpr float       ValenceBoostPower = 0.5f;
+
+// How much emitting one of its triangles next is worth for a vertex
+float VertexScore(std::int32_t CachePosition, std::uint32_t RemainingCount)
+{
+	if( RemainingCount == 0 )
+	{
+		return -1.0f;
+	}
+
+	float Score = 0.0f;
+	if( CachePosition >= 3 )
+	{
+		const float Scaler = 1.0f / (OptimizeCacheSize - 3);
+		Score = std::pow(1.0f - (CachePosition - 3) * Scaler, CacheDecayPower);
+	}
+	else if( CachePosition >= 0 )
+	{
+		// The vertices of the last triangle are scored low on purpose, so
+		// that the strip-like order it produces does not get stuck
+		Score = LastTriangleScore;
+	}
+
+	// Favor vertices with only a few triangles left, to get rid of them
+	Score += ValenceBoostScale
+		   * std::pow(static_cast<float>(RemainingCount), -ValenceBoostPower);
+	return Score;
+}
+
+} // namespace
+
+std::vector<std::uint16_t>
+	UnrollTriangleStrip(std::span<const std::uint16_t> Strip)
+{
+	std::vector<std::uint16_t> Result;
+	if( Strip.size() < 3 )
+	{
+		return Result;
+	}
+	Result.reserve((Strip.size() - 2) * 3);
+
+	for( std::size_t i = 0; i + 2 < Strip.size(); ++i )
+	{
+		std::uint16_t A = Strip[i + 0];
+		std::uint16_t B = Strip[i + 1];
+		std::uint16_t C = Strip[i + 2];
+		if( A == B || B == C || A == C )
+		{
+			continue;
+		}
+
+		// Every other triangle of a strip is wound the other way around
+		if( i % 2 )
+		{
+			std::swap(A, B);
+		}
+
+		Result.insert(Result.end(), {A, B, C});
+	}
+
+	return Result;
+}
+
+void OptimizeVertexCache(std::span<std::uint16_t> Indices)
+{
+	const std::size_t TriangleCount = Indices.size() / 3;
+	if( TriangleCount < 2 )
+	{
+		return;
+	}
+	Indices = Indices.first(TriangleCount * 3);
+
+	const std::size_t VertexCount
+		= *std::max_element(Indices.begin(), Indices.end()) + 1;
+
+	////
+	// Triangles of each vertex that have yet to be emitted. The triangles of
+	// vertex `V` start at `TriangleOffsets[V]`.
+	std::vector<std::uint32_t> RemainingCounts(VertexCount, 0);
+	for( const std::uint16_t CurIndex : Indices )
+	{
+		++RemainingCounts[CurIndex];
+	}
+
+	std::vector<std::uint32_t> TriangleOffsets(VertexCount, 0);
+	std::exclusive_scan(
+		RemainingCounts.begin(), RemainingCounts.end(),
+		TriangleOffsets.begin(), 0U
+	);
+
+	std::vector<std::uint32_t> VertexTriangles(Indices.size());
+	{
+		std::vector<std::uint32_t> Cursors = TriangleOffsets;
+		for( std::size_t i = 0; i < Indices.size(); ++i )
+		{
+			VertexTriangles[Cursors[Indices[i]]++] = i / 3;
+		}
+	}
+	////
+
+	std::vector<std::int32_t> CachePositions(VertexCount, -1);
+	std::vector<float>        VertexScores(VertexCount);
+	for( std::size_t i = 0; i < VertexCount; ++i )
+	{
+		VertexScores[i] = VertexScore(-1, RemainingCounts[i]);
+	}
+
+	const auto TriangleScore = [&](std::size_t TriangleIdx) {
+		return VertexScores[Indices[TriangleIdx * 3 + 0]]
+			 + VertexScores[Indices[TriangleIdx * 3 + 1]]
+			 + VertexScores[Indices[TriangleIdx * 3 + 2]];
+	};
+
+	std::vector<bool> Emitted(TriangleCount, false);
+
+	// Start off with the best triangle of the whole mesh
+	std::size_t BestTriangle = 0;
+	{
+		float BestScore = TriangleScore(0);
+		for( std::size_t i = 1; i < TriangleCount; ++i )
+		{
+			if( const float CurScore = TriangleScore(i); CurScore > BestScore )
+			{
+				BestTriangle = i;
+				BestScore    = CurScore;
+			}
+		}
+	}
+
+	// Vertices in the modeled LRU cache, most recently used first. There is
+	// room for the vertices that are pushed out by a triangle.
+	std::array<std::uint32_t, OptimizeCacheSize + 3> Cache;
+	std::size_t                                      CacheCount = 0;
+
+	// Fallback for when no triangle is left around the cached vertices
+	std::size_t NextTriangle = 0;
+
+	std::vector<std::uint16_t> Result;
+	Result.reserve(Indices.size());
+
+	while( Result.size() < Indices.size() )
+	{
+		const std::span<const std::uint16_t, 3> CurTriangle
+			= Indices.subspan(BestTriangle * 3).first<3>();
+		Result.insert(Result.end(), CurTriangle.begin(), CurTriangle.end());
+		Emitted[BestTriangle] = true;
+
+		std::array<std::uint32_t, OptimizeCacheSize + 3> NewCache;
+		std::size_t                                      NewCacheCount = 0;
+
+		for( const std::uint16_t CurVertex : CurTriangle )
+		{
+			// Take the triangle out of the vertex's remaining triangles
+			const auto Triangles = std::span(VertexTriangles).subspan(
+				TriangleOffsets[CurVertex], RemainingCounts[CurVertex]
+			);
+			std::iter_swap(
+				std::find(Triangles.begin(), Triangles.end(), BestTriangle),
+				Triangles.end() - 1
+			);
+			--RemainingCounts[CurVertex];
+
+			const auto NewCacheEnd = NewCache.begin() + NewCacheCount;
+			if( std::find(NewCache.begin(), NewCacheEnd, CurVertex)
+				== NewCacheEnd )
+			{
+				NewCache[NewCacheCount++] = CurVertex;
+			}
+		}
+
+		for( std::size_t i = 0; i < CacheCount; ++i )
+		{
+			if( std::find(CurTriangle.begin(), CurTriangle.end(), Cache[i])
+				== CurTriangle.end() )
+			{
+				NewCache[NewCacheCount++] = Cache[i];
+			}
+		}
+
+		// Only the vertices that moved within the cache, and the triangles
+		// around them, change their score
+		for( std::size_t i = 0; i < NewCacheCount; ++i )
+		{
+			const std::uint32_t CurVertex = NewCache[i];
+			CachePositions[CurVertex]
+				= i < OptimizeCacheSize ? static_cast<std::int32_t>(i) : -1;
+			VertexScores[CurVertex] = VertexScore(
+				CachePositions[CurVertex], RemainingCounts[CurVertex]
+			);
+		}
+
+		float BestScore = -1.0f;
+		BestTriangle    = TriangleCount;
+		for( std::size_t i = 0; i < NewCacheCount; ++i )
+		{
+			const std::uint32_t CurVertex = NewCache[i];
+			for( std::uint32_t j = 0; j < RemainingCounts[CurVertex]; ++j )
+			{
+				const std::uint32_t CurTriangleIdx
+					= VertexTriangles[TriangleOffsets[CurVertex] + j];
+				if( const float CurScore = TriangleScore(CurTriangleIdx);
+					CurScore > BestScore )
+				{
+					BestTriangle = CurTriangleIdx;
+					BestScore    = CurScore;
+				}
+			}
+		}
+
+		std::copy_n(NewCache.begin(), NewCacheCount, Cache.begin());
+		CacheCount = std::min(NewCacheCount, OptimizeCacheSize);
+
+		if( BestTriangle == TriangleCount && Result.size() < Indices.size() )
+		{
+			while( Emitted[NextTriangle] )
+			{
+				++NextTriangle;
+			}
+			BestTriangle = NextTriangle;
+		}
+	}
+
+	std::copy(Result.begin(), Result.end(), Indices.begin());
+}
+
+std::vector<std::uint32_t> WeldVertices(
+	std::span<std::uint16_t> Indices, std::span<const std::uint32_t> Keys,
+	std::size_t KeySize
+)
+{
+	const std::size_t VertexCount = KeySize ? Keys.size() / KeySize : 0;
+
+	const auto VertexKey = [&](std::uint32_t VertexIdx) {
+		return Keys.subspan(VertexIdx * KeySize, KeySize);
+	};
+
+	// Open-addressed table of the first vertex of every unique key, holding
+	// the vertex index plus one
+	std::size_t TableSize = 16;
+	while( TableSize < VertexCount * 2 )
+	{
+		TableSize *= 2;
+	}
+	std::vector<std::uint32_t> Table(TableSize, 0);
+
+	// FNV-1a over the words of a key
+	const auto HashKey = [](std::span<const std::uint32_t> Key) {
+		std::uint64_t Hash = 0xCBF29CE484222325;
+		for( const std::uint32_t CurWord : Key )
+		{
+			Hash = (Hash ^ CurWord) * 0x100000001B3;
+		}
+		return Hash;
+	};
+
+	// The vertex that each vertex is welded onto
+	std::vector<std::uint32_t> WeldedVertices(VertexCount);
+	for( std::uint32_t VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx )
+	{
+		const auto  CurKey = VertexKey(VertexIdx);
+		std::size_t Slot   = HashKey(CurKey) & (TableSize - 1);
+		while( Table[Slot] != 0
+			   && !std::ranges::equal(VertexKey(Table[Slot] - 1), CurKey) )
+		{
+			Slot = (Slot + 1) & (TableSize - 1);
+		}
+
+		if( Table[Slot] == 0 )
+		{
+			Table[Slot] = VertexIdx + 1;
+		}
+		WeldedVertices[VertexIdx] = Table[Slot] - 1;
+	}
+
+	// Number the vertices in the order they are fetched
+	constexpr std::uint32_t    Unused = ~0U;
+	std::vector<std::uint32_t> NewIndices(VertexCount, Unused);
+	std::vector<std::uint32_t> Result;
+	for( std::uint16_t& CurIndex : Indices )
+	{
+		const std::uint32_t CurVertex = WeldedVertices[CurIndex];
+		if( NewIndices[CurVertex] == Unused )
+		{
+			NewIndices[CurVertex] = Result.size();
+			Result.push_back(CurVertex);
+		}
+		CurIndex = static_cast<std::uint16_t>(NewIndices[CurVertex]);
+	}
+
+	return Result;
+}
+
+std::vector<SkinPartition> PartitionSkin(
+	std::span<const std::uint16_t> Indices,
+	std::span<const std::int32_t> VertexJoints, std::size_t MaxJoints
+)
+{
+	const std::size_t VertexCount = VertexJoints.size() / 4;
+
+	std::vector<SkinPartition> Result;
+
+	// Local index of each joint and vertex within the current partition,
+	// valid if its stamp matches the partition
+	std::vector<std::pair<std::size_t, std::uint16_t>> LocalJoints;
+	std::vector<std::pair<std::size_t, std::uint16_t>> LocalVertices(
+		VertexCount, {~std::size_t(0), 0}
+	);
+
+	const auto InPartition = [&](std::int32_t Joint) {
+		return std::size_t(Joint) < LocalJoints.size()
+			&& LocalJoints[Joint].first == Result.size() - 1;
+	};
+
+	for( std::size_t i = 0; i + 2 < Indices.size(); i += 3 )
+	{
+		const std::span<const std::uint16_t, 3> CurTriangle
+			= Indices.subspan(i).first<3>();
+
+		// Joints of the triangle that the partition does not have yet
+		std::array<std::int32_t, 12> NewJoints;
+		std::size_t                  NewJointCount = 0;
+		for( const std::uint16_t CurVertex : CurTriangle )
+		{
+			for( const std::int32_t CurJoint :
+				 VertexJoints.subspan(CurVertex * 4, 4) )
+			{
+				const auto NewJointsEnd = NewJoints.begin() + NewJointCount;
+				if( CurJoint >= 0
+					&& (Result.empty() || !InPartition(CurJoint))
+					&& std::find(NewJoints.begin(), NewJointsEnd, CurJoint)
+						   == NewJointsEnd )
+				{
+					NewJoints[NewJointCount++] = CurJoint;
+				}
+			}
+		}
+
+		if( Result.empty()
+			|| (!Result.back().Indices.empty()
+				&& Result.back().Joints.size() + NewJointCount > MaxJoints) )
+		{
+			Result.emplace_back();
+
+			// Every joint is new to an empty partition
+			NewJointCount = 0;
+			for( const std::uint16_t CurVertex : CurTriangle )
+			{
+				for( const std::int32_t CurJoint :
+					 VertexJoints.subspan(CurVertex * 4, 4) )
+				{
+					const auto NewJointsEnd = NewJoints.begin() + NewJointCount;
+					if( CurJoint >= 0
+						&& std::find(NewJoints.begin(), NewJointsEnd, CurJoint)
+							   == NewJointsEnd )
+					{
+						NewJoints[NewJointCount++] = CurJoint;
+					}
+				}
+			}
+		}
+		SkinPartition& CurPartition = Result.back();
+
+		for( std::size_t j = 0; j < NewJointCount; ++j )
+		{
+			const std::int32_t CurJoint = NewJoints[j];
+			if( std::size_t(CurJoint) >= LocalJoints.size() )
+			{
+				LocalJoints.resize(CurJoint + 1, {~std::size_t(0), 0});
+			}
+			LocalJoints[CurJoint] = {
+				Result.size() - 1,
+				static_cast<std::uint16_t>(CurPartition.Joints.size())
+			};
+			CurPartition.Joints.push_back(CurJoint);
+		}
+
+		for( const std::uint16_t CurVertex : CurTriangle )
+		{
+			auto& [Stamp, LocalVertex] = LocalVertices[CurVertex];
+			if( Stamp != Result.size() - 1 )
+			{
+				Stamp       = Result.size() - 1;
+				LocalVertex = CurPartition.Vertices.size();
+				CurPartition.Vertices.push_back(CurVertex);
+			}
+			CurPartition.Indices.push_back(LocalVertex);
+		}
+	}
+
+	return Result;
+}
+
+float ComputeACMR(
+	std::span<const std::uint16_t> Indices, std::size_t CacheSize
+)
+{
+	const std::size_t TriangleCount = Indices.size() / 3;
+	if( TriangleCount == 0 || CacheSize == 0 )
+	{
+		return 0.0f;
+	}
+
+	// Ring-buffer of the most recently transformed vertices
+	std::vector<std::uint16_t> Cache;
+	Cache.reserve(CacheSize);
+	std::size_t CacheHead = 0;
+
+	std::size_t MissCount = 0;
+	for( const std::uint16_t CurIndex : Indices.first(TriangleCount * 3) )
+	{
+		if( std::find(Cache.begin(), Cache.end(), CurIndex) != Cache.end() )
+		{
+			continue;
+		}
+
+		++MissCount;
+		if( Cache.size() < CacheSize )
+		{
+			Cache.push_back(CurIndex);
+		}
+		else
+		{
+			Cache[CacheHead] = CurIndex;
+			CacheHead        = (CacheHead + 1) % CacheSize;
+		}
+	}
+
+	return static_cast<float>(MissCount) / TriangleCount;
+}
+
+} // namespace TsuHan
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace TsuHan
+{
+
+// Unrolls a triangle strip into a triangle list with the same winding.
+// Degenerate triangles, which strips use to stitch runs together, are
+// dropped.
+std::vector<std::uint16_t>
+	UnrollTriangleStrip(std::span<const std::uint16_t> Strip);
+
+// Reorders the triangles of a triangle list to make better use of the
+// post-transform vertex cache, using Tom Forsyth's "Linear-Speed Vertex
+// Cache Optimisation". The winding of each triangle is kept.
+void OptimizeVertexCache(std::span<std::uint16_t> Indices);
+
+// Merges the vertices whose keys are equal and renumbers the remaining
+// vertices in the order they are first used by `Indices`, which is remapped
+// to match. Each vertex has `KeySize` words of `Keys`. Vertices that are
+// never used are dropped. Returns the source vertex of each new vertex.
+std::vector<std::uint32_t> WeldVertices(
+	std::span<std::uint16_t> Indices, std::span<const std::uint32_t> Keys,
+	std::size_t KeySize
+);
+
+struct SkinPartition
+{
+	// Source joint of each joint of the partition
+	std::vector<std::uint16_t> Joints;
+	// Source vertex of each vertex of the partition
+	std::vector<std::uint32_t> Vertices;
+	// Triangle list of the partition's own vertices
+	std::vector<std::uint16_t> Indices;
+};
+
+// Splits a triangle list into partitions that each use at most `MaxJoints`
+// joints, keeping the order of the triangles. `VertexJoints` holds the four
+// joints of each vertex, which are -1 when unused. A triangle that uses more
+// than `MaxJoints` joints on its own gets a partition of its own.
+std::vector<SkinPartition> PartitionSkin(
+	std::span<const std::uint16_t> Indices,
+	std::span<const std::int32_t> VertexJoints, std::size_t MaxJoints
+);
+
+// Average cache miss ratio: the amount of vertices transformed per triangle
+// of a triangle list, simulated on a FIFO cache of `CacheSize` vertices
+float ComputeACMR(
+	std::span<const std::uint16_t> Indices, std::size_t CacheSize
+);
+
+} // namespace TsuHan
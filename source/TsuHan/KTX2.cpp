@@ -0,0 +1,199 @@
+#include "KTX2.hpp"
+
+#include <array>
+#include <stdexcept>
+#include <string_view>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+constexpr std::array<std::uint8_t, 12> KTX2Identifier = {
+	0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A,
+};
+
+// Identifier, header and index
+constexpr std::size_t KTX2HeaderSize = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+constexpr std::size_t KTX2LevelSize  = 3 * 8;
+
+// VkFormat
+constexpr std::uint32_t VkFormatBC1RGBSRGB = 132;
+constexpr std::uint32_t VkFormatBC3SRGB    = 138;
+
+// Data format descriptor
+constexpr std::size_t   DFDBasicBlockSize  = 24;
+constexpr std::size_t   DFDSampleSize      = 16;
+constexpr std::uint32_t DFDVersion         = 2;
+constexpr std::uint8_t  DFDModelBC1A       = 128;
+constexpr std::uint8_t  DFDModelBC3        = 130;
+constexpr std::uint8_t  DFDPrimariesBT709  = 1;
+constexpr std::uint8_t  DFDTransferSRGB    = 2;
+constexpr std::uint8_t  DFDChannelColor    = 0;
+constexpr std::uint8_t  DFDChannelBC3Alpha = 15;
+
+constexpr std::string_view KTX2Writer = "KTXwriter";
+constexpr std::string_view WriterName = "TsuHanTools";
+
+void WriteU32LE(std::vector<std::byte>& Out, std::uint32_t Value)
+{
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Out.push_back(static_cast<std::byte>(Value >> (i * 8)));
+	}
+}
+
+void WriteU64LE(std::vector<std::byte>& Out, std::uint64_t Value)
+{
+	WriteU32LE(Out, static_cast<std::uint32_t>(Value));
+	WriteU32LE(Out, static_cast<std::uint32_t>(Value >> 32));
+}
+
+void WriteDFDSample(
+	std::vector<std::byte>& Out, std::uint8_t Channel, std::uint16_t BitOffset
+)
+{
+	// Each sample spans a whole 64-bit half of the block
+	WriteU32LE(Out, BitOffset | (63u << 16) | (std::uint32_t(Channel) << 24));
+	WriteU32LE(Out, 0);          // Sample position
+	WriteU32LE(Out, 0);          // Lower
+	WriteU32LE(Out, 0xFFFFFFFF); // Upper
+}
+
+std::vector<std::byte> GetDFD(BlockFormat Format)
+{
+	const std::size_t SampleCount = Format == BlockFormat::BC3 ? 2 : 1;
+	const std::size_t BlockSize
+		= DFDBasicBlockSize + SampleCount * DFDSampleSize;
+
+	std::vector<std::byte> Result;
+	WriteU32LE(Result, static_cast<std::uint32_t>(4 + BlockSize));
+
+	// Khronos vendor and basic descriptor type
+	WriteU32LE(Result, 0);
+	WriteU32LE(Result, DFDVersion | (std::uint32_t(BlockSize) << 16));
+
+	const std::uint8_t Model
+		= Format == BlockFormat::BC3 ? DFDModelBC3 : DFDModelBC1A;
+	WriteU32LE(
+		Result, Model | (DFDPrimariesBT709 << 8) | (DFDTransferSRGB << 16)
+	);
+
+	// 4x4 texels, stored as dimension minus one
+	WriteU32LE(Result, 3 | (3 << 8));
+
+	// Bytes of each block
+	WriteU32LE(Result, static_cast<std::uint32_t>(GetBlockSize(Format)));
+	WriteU32LE(Result, 0);
+
+	if( Format == BlockFormat::BC3 )
+	{
+		WriteDFDSample(Result, DFDChannelBC3Alpha, 0);
+		WriteDFDSample(Result, DFDChannelColor, 64);
+	}
+	else
+	{
+		WriteDFDSample(Result, DFDChannelColor, 0);
+	}
+	return Result;
+}
+
+std::vector<std::byte> GetKeyValueData()
+{
+	std::vector<std::byte> Result;
+	WriteU32LE(
+		Result, static_cast<std::uint32_t>(
+					KTX2Writer.size() + 1 + WriterName.size() + 1
+				)
+	);
+	for( const std::string_view CurString : {KTX2Writer, WriterName} )
+	{
+		for( const char CurChar : CurString )
+		{
+			Result.push_back(static_cast<std::byte>(CurChar));
+		}
+		Result.push_back(std::byte{0});
+	}
+	Result.resize((Result.size() + 3) & ~std::size_t(3));
+	return Result;
+}
+
+} // namespace
+
+std::vector<std::byte> EncodeKTX2(
+	BlockFormat Format, std::uint32_t Width, std::uint32_t Height,
+	std::span<const std::vector<std::byte>> Levels
+)
+{
+	if( Levels.empty() )
+	{
+		throw std::out_of_range("KTX2 texture has no levels");
+	}
+
+	const std::vector<std::byte> DFD          = GetDFD(Format);
+	const std::vector<std::byte> KeyValueData = GetKeyValueData();
+
+	const std::size_t DFDOffset
+		= KTX2HeaderSize + Levels.size() * KTX2LevelSize;
+	const std::size_t KeyValueOffset = DFDOffset + DFD.size();
+
+	// Levels are stored smallest first, each aligned to a whole block
+	const std::size_t        Alignment = GetBlockSize(Format);
+	std::vector<std::size_t> LevelOffsets(Levels.size());
+	std::size_t              DataSize = KeyValueOffset + KeyValueData.size();
+	for( std::size_t i = Levels.size(); i-- > 0; )
+	{
+		DataSize        = (DataSize + Alignment - 1) / Alignment * Alignment;
+		LevelOffsets[i] = DataSize;
+		DataSize += Levels[i].size();
+	}
+
+	std::vector<std::byte> Result;
+	Result.reserve(DataSize);
+
+	for( const std::uint8_t CurByte : KTX2Identifier )
+	{
+		Result.push_back(static_cast<std::byte>(CurByte));
+	}
+
+	WriteU32LE(
+		Result,
+		Format == BlockFormat::BC3 ? VkFormatBC3SRGB : VkFormatBC1RGBSRGB
+	);
+	WriteU32LE(Result, 1); // Type size
+	WriteU32LE(Result, Width);
+	WriteU32LE(Result, Height);
+	WriteU32LE(Result, 0); // Depth
+	WriteU32LE(Result, 0); // Layers
+	WriteU32LE(Result, 1); // Faces
+	WriteU32LE(Result, static_cast<std::uint32_t>(Levels.size()));
+	WriteU32LE(Result, 0); // No supercompression
+
+	WriteU32LE(Result, static_cast<std::uint32_t>(DFDOffset));
+	WriteU32LE(Result, static_cast<std::uint32_t>(DFD.size()));
+	WriteU32LE(Result, static_cast<std::uint32_t>(KeyValueOffset));
+	WriteU32LE(Result, static_cast<std::uint32_t>(KeyValueData.size()));
+	WriteU64LE(Result, 0); // No supercompression global data
+	WriteU64LE(Result, 0);
+
+	for( std::size_t i = 0; i < Levels.size(); ++i )
+	{
+		WriteU64LE(Result, LevelOffsets[i]);
+		WriteU64LE(Result, Levels[i].size());
+		WriteU64LE(Result, Levels[i].size());
+	}
+
+	Result.insert(Result.end(), DFD.begin(), DFD.end());
+	Result.insert(Result.end(), KeyValueData.begin(), KeyValueData.end());
+
+	for( std::size_t i = Levels.size(); i-- > 0; )
+	{
+		Result.resize(LevelOffsets[i]);
+		Result.insert(Result.end(), Levels[i].begin(), Levels[i].end());
+	}
+
+	return Result;
+}
+
+} // namespace TsuHan
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "BlockCompress.hpp"
+
+namespace TsuHan
+{
+
+// Encodes block-compressed sRGB mip levels as a KTX2 texture. `Levels` is
+// the full mip chain, largest level first, of an image of `Width`x`Height`.
+std::vector<std::byte> EncodeKTX2(
+	BlockFormat Format, std::uint32_t Width, std::uint32_t Height,
+	std::span<const std::vector<std::byte>> Levels
+);
+
+} // namespace TsuHan
@@ -0,0 +1,160 @@
+#include <TsuHan/PackReader.hpp>
+
+#include <TsuHan/Decrypt.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <utility>
+
+#include <mio/mmap.hpp>
+
+namespace TsuHan
+{
+
+struct PackReader::Impl
+{
+	PackFileInfo      Info;
+	mio::mmap_source  MappedFile;
+	const std::size_t CacheCapacity;
+
+	// Most recently used entries at the front
+	std::mutex                                   CacheMutex;
+	std::list<std::pair<std::string, EntryData>> Cache;
+
+	Impl(
+		const std::filesystem::path& PackPath, const PackFileInfo& FileInfo,
+		std::size_t Capacity
+	)
+		: Info(FileInfo), MappedFile(PackPath.string()),
+		  CacheCapacity(Capacity)
+	{
+	}
+
+	std::span<const std::byte> GetEncryptedEntry(const std::string& EntryName
+	) const
+	{
+		const PackFileInfo::FileSpan& FileSpan = Info.Files.at(EntryName);
+
+		const auto FileData = std::span<const std::byte>(
+			reinterpret_cast<const std::byte*>(MappedFile.data()),
+			MappedFile.size()
+		);
+
+		// Clamp to the end of the pack in case of a truncated file
+		if( FileSpan.Offset >= FileData.size() )
+		{
+			return {};
+		}
+		return FileData.subspan(
+			FileSpan.Offset,
+			std::min<std::size_t>(
+				FileSpan.Size, FileData.size() - FileSpan.Offset
+			)
+		);
+	}
+
+	EntryData FindCached(const std::string& EntryName)
+	{
+		const std::lock_guard Lock(CacheMutex);
+
+		const auto CacheEntry = std::find_if(
+			Cache.begin(), Cache.end(),
+			[&](const auto& CurEntry) { return CurEntry.first == EntryName; }
+		);
+
+		if( CacheEntry == Cache.end() )
+		{
+			return {};
+		}
+
+		// Move to the front
+		Cache.splice(Cache.begin(), Cache, CacheEntry);
+		return Cache.front().second;
+	}
+};
+
+PackReader::PackReader(
+	const std::filesystem::path& PackPath, const PackFileInfo& Info,
+	std::size_t CacheCapacity
+)
+	: PImpl(std::make_unique<Impl>(PackPath, Info, CacheCapacity))
+{
+}
+
+PackReader::~PackReader() = default;
+
+PackReader::PackReader(PackReader&&) noexcept            = default;
+PackReader& PackReader::operator=(PackReader&&) noexcept = default;
+
+const PackFileInfo& PackReader::GetInfo() const
+{
+	return PImpl->Info;
+}
+
+bool PackReader::Contains(const std::string& EntryName) const
+{
+	return PImpl->Info.Files.contains(EntryName);
+}
+
+std::size_t PackReader::GetEntrySize(const std::string& EntryName) const
+{
+	return PImpl->GetEncryptedEntry(EntryName).size();
+}
+
+PackReader::EntryData PackReader::View(const std::string& EntryName)
+{
+	if( EntryData Cached = PImpl->FindCached(EntryName) )
+	{
+		return Cached;
+	}
+
+	const std::span<const std::byte> EncryptedData
+		= PImpl->GetEncryptedEntry(EntryName);
+
+	auto DecryptedData
+		= std::make_shared<std::vector<std::byte>>(EncryptedData.size());
+	XORDecrypt(
+		EncryptedData, *DecryptedData, PImpl->Info.Key,
+		PImpl->Info.Files.at(EntryName).Offset
+	);
+
+	if( PImpl->CacheCapacity != 0 )
+	{
+		const std::lock_guard Lock(PImpl->CacheMutex);
+		PImpl->Cache.emplace_front(EntryName, DecryptedData);
+		while( PImpl->Cache.size() > PImpl->CacheCapacity )
+		{
+			PImpl->Cache.pop_back();
+		}
+	}
+
+	return DecryptedData;
+}
+
+std::size_t PackReader::Read(
+	const std::string& EntryName, std::span<std::byte> Dest,
+	std::size_t Offset
+) const
+{
+	const std::span<const std::byte> EncryptedData
+		= PImpl->GetEncryptedEntry(EntryName);
+
+	if( Offset >= EncryptedData.size() )
+	{
+		return 0;
+	}
+
+	const std::size_t ReadSize
+		= std::min(Dest.size(), EncryptedData.size() - Offset);
+
+	XORDecrypt(
+		EncryptedData.subspan(Offset, ReadSize), Dest.first(ReadSize),
+		PImpl->Info.Key, PImpl->Info.Files.at(EntryName).Offset + Offset
+	);
+
+	return ReadSize;
+}
+
+} // namespace TsuHan
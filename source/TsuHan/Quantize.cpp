@@ -0,0 +1,577 @@
+#include "Quantize.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)                                     \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSUHAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// Both the scalar and the vector kernels do the exact same float operations
+// in the same order, so that the result does not depend on which kernel
+// converted a vertex.
+
+std::array<std::uint8_t, 4>
+	QuantizeWeight(const std::byte* Source, std::size_t WeightCount)
+{
+	std::array<float, 4> Weights = {};
+	std::memcpy(Weights.data(), Source, WeightCount * sizeof(float));
+
+	const float Sum = (Weights[0] + Weights[1]) + (Weights[2] + Weights[3]);
+
+	// Vertices without weights go entirely to their first joint
+	std::array<float, 4> Scaled = {255.0f, 0.0f, 0.0f, 0.0f};
+	if( Sum > 0.0f )
+	{
+		const float Scale = 255.0f / Sum;
+		for( std::size_t i = 0; i < 4; ++i )
+		{
+			Scaled[i] = Weights[i] * Scale;
+		}
+	}
+
+	std::array<std::int32_t, 4> Quantized;
+	std::int32_t                Total = 0;
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Quantized[i] = static_cast<std::int32_t>(std::nearbyint(Scaled[i]));
+		Total += Quantized[i];
+	}
+
+	// Rounding may leave the total a few units off, which goes to the
+	// largest weight where it makes the smallest relative difference
+	const std::size_t Largest
+		= std::max_element(Scaled.begin(), Scaled.end()) - Scaled.begin();
+	Quantized[Largest] += 255 - Total;
+
+	std::array<std::uint8_t, 4> Result;
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Result[i] = static_cast<std::uint8_t>(std::clamp(Quantized[i], 0, 255));
+	}
+	return Result;
+}
+
+std::array<std::uint16_t, 4> QuantizeJoint(const std::byte* Source)
+{
+	std::array<float, 4> Joints;
+	std::memcpy(Joints.data(), Source, sizeof(Joints));
+
+	std::array<std::uint16_t, 4> Result;
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Result[i] = static_cast<std::uint16_t>(
+			std::clamp(std::trunc(Joints[i]), 0.0f, 65535.0f)
+		);
+	}
+	return Result;
+}
+
+// Snaps a vector onto the unit sphere and then onto the snorm8 grid
+template<std::size_t N>
+std::array<std::int8_t, N> QuantizeDirection(const std::byte* Source)
+{
+	std::array<float, 3> Direction;
+	std::memcpy(Direction.data(), Source, sizeof(Direction));
+
+	const float Length = std::sqrt(
+		Direction[0] * Direction[0] + Direction[1] * Direction[1]
+		+ Direction[2] * Direction[2]
+	);
+	const float Scale = Length > 0.0f ? 127.0f / Length : 0.0f;
+
+	// The fourth component is the handedness of a tangent, which the source
+	// does not store
+	std::array<std::int8_t, N> Result;
+	Result.fill(127);
+	for( std::size_t i = 0; i < 3; ++i )
+	{
+		Result[i] = static_cast<std::int8_t>(
+			std::clamp(std::nearbyint(Direction[i] * Scale), -127.0f, 127.0f)
+		);
+	}
+	return Result;
+}
+
+template<typename T, std::size_t N>
+std::array<T, N> QuantizeUnorm(const std::byte* Source)
+{
+	constexpr float Range = std::numeric_limits<T>::max();
+
+	std::array<float, N> Values;
+	std::memcpy(Values.data(), Source, sizeof(Values));
+
+	std::array<T, N> Result;
+	for( std::size_t i = 0; i < N; ++i )
+	{
+		Result[i] = static_cast<T>(
+			std::nearbyint(std::clamp(Values[i], 0.0f, 1.0f) * Range)
+		);
+	}
+	return Result;
+}
+
+template<typename T, std::size_t N>
+void ResetBounds(std::span<T, N> Min, std::span<T, N> Max)
+{
+	std::fill(Min.begin(), Min.end(), std::numeric_limits<T>::max());
+	std::fill(Max.begin(), Max.end(), std::numeric_limits<T>::lowest());
+}
+
+// Converts the vertices from `FirstVertex` onwards one at a time. `Convert`
+// reads the attribute of a single vertex and returns its new components.
+template<typename T, std::size_t N, typename ConvertProc>
+void ConvertVertices(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t FirstVertex,
+	std::size_t VertexCount, std::span<T, N> Min, std::span<T, N> Max,
+	ConvertProc Convert
+)
+{
+	for( std::size_t VertexIdx = FirstVertex; VertexIdx < VertexCount;
+		 ++VertexIdx )
+	{
+		const std::array<T, N> Converted
+			= Convert(Source.data() + VertexIdx * SourceStride);
+		std::memcpy(
+			Dest.data() + VertexIdx * DestStride, Converted.data(),
+			sizeof(Converted)
+		);
+
+		for( std::size_t i = 0; i < N; ++i )
+		{
+			Min[i] = std::min(Min[i], Converted[i]);
+			Max[i] = std::max(Max[i], Converted[i]);
+		}
+	}
+}
+
+#if defined(TSUHAN_SSE2)
+
+// Each kernel converts as many vertices as it can with its widest registers
+// and returns the amount of vertices processed
+
+std::size_t QuantizeWeightsSSE2(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::size_t WeightCount, std::span<std::uint8_t, 4> Min,
+	std::span<std::uint8_t, 4> Max
+)
+{
+	// Every vertex is loaded as four floats, which must not read past the
+	// end of the source for the last vertices
+	if( Source.size() < sizeof(__m128) )
+	{
+		return 0;
+	}
+	const std::size_t LoadableCount = std::min(
+		VertexCount, (Source.size() - sizeof(__m128)) / SourceStride + 1
+	);
+	const std::size_t VectorCount = LoadableCount / 4 * 4;
+
+	// Clears the floats past the active weights
+	const __m128 WeightMask = _mm_castsi128_ps(_mm_cmplt_epi32(
+		_mm_setr_epi32(0, 1, 2, 3),
+		_mm_set1_epi32(static_cast<std::int32_t>(WeightCount))
+	));
+
+	__m128i MinBytes = _mm_set1_epi8(-1);
+	__m128i MaxBytes = _mm_setzero_si128();
+
+	for( std::size_t VertexIdx = 0; VertexIdx < VectorCount; VertexIdx += 4 )
+	{
+		const auto LoadWeights = [&](std::size_t Index) {
+			const auto* CurSource = reinterpret_cast<const float*>(
+				Source.data() + (VertexIdx + Index) * SourceStride
+			);
+			return _mm_and_ps(_mm_loadu_ps(CurSource), WeightMask);
+		};
+
+		// Transposed so that each register holds one weight of four vertices
+		__m128 W0 = LoadWeights(0);
+		__m128 W1 = LoadWeights(1);
+		__m128 W2 = LoadWeights(2);
+		__m128 W3 = LoadWeights(3);
+		_MM_TRANSPOSE4_PS(W0, W1, W2, W3);
+
+		const __m128 Sum   = _mm_add_ps(_mm_add_ps(W0, W1), _mm_add_ps(W2, W3));
+		const __m128 Valid = _mm_cmpgt_ps(Sum, _mm_setzero_ps());
+		const __m128 Scale = _mm_div_ps(_mm_set1_ps(255.0f), Sum);
+
+		const __m128 S0 = _mm_or_ps(
+			_mm_and_ps(Valid, _mm_mul_ps(W0, Scale)),
+			_mm_andnot_ps(Valid, _mm_set1_ps(255.0f))
+		);
+		const __m128 S1 = _mm_and_ps(Valid, _mm_mul_ps(W1, Scale));
+		const __m128 S2 = _mm_and_ps(Valid, _mm_mul_ps(W2, Scale));
+		const __m128 S3 = _mm_and_ps(Valid, _mm_mul_ps(W3, Scale));
+
+		__m128i Q0 = _mm_cvtps_epi32(S0);
+		__m128i Q1 = _mm_cvtps_epi32(S1);
+		__m128i Q2 = _mm_cvtps_epi32(S2);
+		__m128i Q3 = _mm_cvtps_epi32(S3);
+
+		const __m128i Total
+			= _mm_add_epi32(_mm_add_epi32(Q0, Q1), _mm_add_epi32(Q2, Q3));
+		const __m128i Error = _mm_sub_epi32(_mm_set1_epi32(255), Total);
+
+		// Select the first of the largest weights
+		const __m128 Largest
+			= _mm_max_ps(_mm_max_ps(S0, S1), _mm_max_ps(S2, S3));
+		const __m128 Is0   = _mm_cmpeq_ps(S0, Largest);
+		const __m128 Is1   = _mm_andnot_ps(Is0, _mm_cmpeq_ps(S1, Largest));
+		__m128       Taken = _mm_or_ps(Is0, Is1);
+		const __m128 Is2   = _mm_andnot_ps(Taken, _mm_cmpeq_ps(S2, Largest));
+		Taken              = _mm_or_ps(Taken, Is2);
+		const __m128 Is3   = _mm_andnot_ps(Taken, _mm_cmpeq_ps(S3, Largest));
+
+		Q0 = _mm_add_epi32(Q0, _mm_and_si128(_mm_castps_si128(Is0), Error));
+		Q1 = _mm_add_epi32(Q1, _mm_and_si128(_mm_castps_si128(Is1), Error));
+		Q2 = _mm_add_epi32(Q2, _mm_and_si128(_mm_castps_si128(Is2), Error));
+		Q3 = _mm_add_epi32(Q3, _mm_and_si128(_mm_castps_si128(Is3), Error));
+
+		// Back to one vertex per register
+		__m128 V0 = _mm_castsi128_ps(Q0);
+		__m128 V1 = _mm_castsi128_ps(Q1);
+		__m128 V2 = _mm_castsi128_ps(Q2);
+		__m128 V3 = _mm_castsi128_ps(Q3);
+		_MM_TRANSPOSE4_PS(V0, V1, V2, V3);
+
+		const __m128i Packed = _mm_packus_epi16(
+			_mm_packs_epi32(_mm_castps_si128(V0), _mm_castps_si128(V1)),
+			_mm_packs_epi32(_mm_castps_si128(V2), _mm_castps_si128(V3))
+		);
+
+		MinBytes = _mm_min_epu8(MinBytes, Packed);
+		MaxBytes = _mm_max_epu8(MaxBytes, Packed);
+
+		alignas(16) std::array<std::uint8_t, 16> PackedBytes;
+		_mm_store_si128(
+			reinterpret_cast<__m128i*>(PackedBytes.data()), Packed
+		);
+		for( std::size_t i = 0; i < 4; ++i )
+		{
+			std::memcpy(
+				Dest.data() + (VertexIdx + i) * DestStride,
+				PackedBytes.data() + i * 4, 4
+			);
+		}
+	}
+
+	alignas(16) std::array<std::uint8_t, 16> MinLanes;
+	alignas(16) std::array<std::uint8_t, 16> MaxLanes;
+	_mm_store_si128(reinterpret_cast<__m128i*>(MinLanes.data()), MinBytes);
+	_mm_store_si128(reinterpret_cast<__m128i*>(MaxLanes.data()), MaxBytes);
+	for( std::size_t i = 0; i < 16; ++i )
+	{
+		Min[i % 4] = std::min(Min[i % 4], MinLanes[i]);
+		Max[i % 4] = std::max(Max[i % 4], MaxLanes[i]);
+	}
+
+	return VectorCount;
+}
+
+std::size_t QuantizeJointsSSE2(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint16_t, 4> Min, std::span<std::uint16_t, 4> Max
+)
+{
+	const std::size_t VectorCount = VertexCount / 2 * 2;
+
+	// SSE2 can only pack to signed 16-bit integers, so the joints are biased
+	// into the signed range and back. This also saturates them to uint16.
+	const __m128i Bias32 = _mm_set1_epi32(0x8000);
+	const __m128i Bias16 = _mm_set1_epi16(static_cast<std::int16_t>(0x8000));
+
+	__m128i MinBiased = _mm_set1_epi16(0x7FFF);
+	__m128i MaxBiased = _mm_set1_epi16(static_cast<std::int16_t>(0x8000));
+
+	for( std::size_t VertexIdx = 0; VertexIdx < VectorCount; VertexIdx += 2 )
+	{
+		std::byte* const Dest0 = Dest.data() + (VertexIdx + 0) * DestStride;
+		std::byte* const Dest1 = Dest.data() + (VertexIdx + 1) * DestStride;
+
+		const __m128i J0 = _mm_cvttps_epi32(_mm_loadu_ps(
+			reinterpret_cast<const float*>(
+				Source.data() + (VertexIdx + 0) * SourceStride
+			)
+		));
+		const __m128i J1 = _mm_cvttps_epi32(_mm_loadu_ps(
+			reinterpret_cast<const float*>(
+				Source.data() + (VertexIdx + 1) * SourceStride
+			)
+		));
+
+		const __m128i Biased = _mm_packs_epi32(
+			_mm_sub_epi32(J0, Bias32), _mm_sub_epi32(J1, Bias32)
+		);
+
+		MinBiased = _mm_min_epi16(MinBiased, Biased);
+		MaxBiased = _mm_max_epi16(MaxBiased, Biased);
+
+		const __m128i Packed = _mm_xor_si128(Biased, Bias16);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(Dest0), Packed);
+		_mm_storel_epi64(
+			reinterpret_cast<__m128i*>(Dest1), _mm_srli_si128(Packed, 8)
+		);
+	}
+
+	alignas(16) std::array<std::uint16_t, 8> MinLanes;
+	alignas(16) std::array<std::uint16_t, 8> MaxLanes;
+	_mm_store_si128(
+		reinterpret_cast<__m128i*>(MinLanes.data()),
+		_mm_xor_si128(MinBiased, Bias16)
+	);
+	_mm_store_si128(
+		reinterpret_cast<__m128i*>(MaxLanes.data()),
+		_mm_xor_si128(MaxBiased, Bias16)
+	);
+	for( std::size_t i = 0; i < 8; ++i )
+	{
+		Min[i % 4] = std::min(Min[i % 4], MinLanes[i]);
+		Max[i % 4] = std::max(Max[i % 4], MaxLanes[i]);
+	}
+
+	return VectorCount;
+}
+
+// Bounds are kept in registers of four floats each, the last of which
+// overlaps the one before it if the floats of a vertex are not a multiple
+// of four. Bounds are seeded from the first vertex by the caller.
+std::size_t FloatBoundsSSE2(
+	std::span<const std::byte> Source, std::size_t SourceStride,
+	std::size_t VertexCount, std::span<float> Min, std::span<float> Max
+)
+{
+	constexpr std::size_t MaxRegisterCount = 16;
+
+	const std::size_t FloatCount    = Min.size();
+	const std::size_t RegisterCount = (FloatCount + 3) / 4;
+	if( FloatCount < 4 || RegisterCount > MaxRegisterCount )
+	{
+		return 1;
+	}
+
+	// Plain arrays, as std::array would drop the alignment of __m128
+	std::size_t Offsets[MaxRegisterCount];
+	__m128      MinFloats[MaxRegisterCount];
+	__m128      MaxFloats[MaxRegisterCount];
+	for( std::size_t i = 0; i < RegisterCount; ++i )
+	{
+		Offsets[i]   = std::min(i * 4, FloatCount - 4);
+		MinFloats[i] = _mm_loadu_ps(Min.data() + Offsets[i]);
+		MaxFloats[i] = _mm_loadu_ps(Max.data() + Offsets[i]);
+	}
+
+	for( std::size_t VertexIdx = 1; VertexIdx < VertexCount; ++VertexIdx )
+	{
+		const auto* CurSource = reinterpret_cast<const float*>(
+			Source.data() + VertexIdx * SourceStride
+		);
+		for( std::size_t i = 0; i < RegisterCount; ++i )
+		{
+			// Same operand order as std::min/std::max
+			const __m128 CurFloats = _mm_loadu_ps(CurSource + Offsets[i]);
+			MinFloats[i]           = _mm_min_ps(CurFloats, MinFloats[i]);
+			MaxFloats[i]           = _mm_max_ps(CurFloats, MaxFloats[i]);
+		}
+	}
+
+	for( std::size_t i = 0; i < RegisterCount; ++i )
+	{
+		_mm_storeu_ps(Min.data() + Offsets[i], MinFloats[i]);
+		_mm_storeu_ps(Max.data() + Offsets[i], MaxFloats[i]);
+	}
+
+	return VertexCount;
+}
+
+#endif
+
+} // namespace
+
+void CopyVertices(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::size_t AttributeSize
+)
+{
+	for( std::size_t VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx )
+	{
+		std::memcpy(
+			Dest.data() + VertexIdx * DestStride,
+			Source.data() + VertexIdx * SourceStride, AttributeSize
+		);
+	}
+}
+
+void QuantizePositions(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<const float, 3> Offset, float Scale,
+	std::span<std::int16_t, 3> Min, std::span<std::int16_t, 3> Max
+)
+{
+	ResetBounds(Min, Max);
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, 0, VertexCount, Min, Max,
+		[&](const std::byte* CurSource) {
+			std::array<float, 3> Position;
+			std::memcpy(Position.data(), CurSource, sizeof(Position));
+
+			std::array<std::int16_t, 3> Result;
+			for( std::size_t i = 0; i < 3; ++i )
+			{
+				Result[i] = static_cast<std::int16_t>(std::clamp(
+					std::nearbyint((Position[i] - Offset[i]) / Scale),
+					-32767.0f, 32767.0f
+				));
+			}
+			return Result;
+		}
+	);
+}
+
+void QuantizeNormals(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::int8_t, 3> Min, std::span<std::int8_t, 3> Max
+)
+{
+	ResetBounds(Min, Max);
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, 0, VertexCount, Min, Max,
+		QuantizeDirection<3>
+	);
+}
+
+void QuantizeTangents(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::int8_t, 4> Min, std::span<std::int8_t, 4> Max
+)
+{
+	ResetBounds(Min, Max);
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, 0, VertexCount, Min, Max,
+		QuantizeDirection<4>
+	);
+}
+
+void QuantizeColors(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint8_t, 4> Min, std::span<std::uint8_t, 4> Max
+)
+{
+	ResetBounds(Min, Max);
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, 0, VertexCount, Min, Max,
+		QuantizeUnorm<std::uint8_t, 4>
+	);
+}
+
+void QuantizeTexCoords(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint16_t, 2> Min, std::span<std::uint16_t, 2> Max
+)
+{
+	ResetBounds(Min, Max);
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, 0, VertexCount, Min, Max,
+		QuantizeUnorm<std::uint16_t, 2>
+	);
+}
+
+void QuantizeWeights(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::size_t WeightCount, std::span<std::uint8_t, 4> Min,
+	std::span<std::uint8_t, 4> Max
+)
+{
+	ResetBounds(Min, Max);
+
+	std::size_t VertexIdx = 0;
+#if defined(TSUHAN_SSE2)
+	VertexIdx = QuantizeWeightsSSE2(
+		Source, Dest, SourceStride, DestStride, VertexCount, WeightCount, Min,
+		Max
+	);
+#endif
+
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, VertexIdx, VertexCount, Min,
+		Max,
+		[WeightCount](const std::byte* CurSource) {
+			return QuantizeWeight(CurSource, WeightCount);
+		}
+	);
+}
+
+void QuantizeJoints(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint16_t, 4> Min, std::span<std::uint16_t, 4> Max
+)
+{
+	ResetBounds(Min, Max);
+
+	std::size_t VertexIdx = 0;
+#if defined(TSUHAN_SSE2)
+	VertexIdx = QuantizeJointsSSE2(
+		Source, Dest, SourceStride, DestStride, VertexCount, Min, Max
+	);
+#endif
+
+	ConvertVertices(
+		Source, Dest, SourceStride, DestStride, VertexIdx, VertexCount, Min,
+		Max, QuantizeJoint
+	);
+}
+
+void FloatBounds(
+	std::span<const std::byte> Source, std::size_t SourceStride,
+	std::size_t VertexCount, std::span<float> Min, std::span<float> Max
+)
+{
+	if( VertexCount == 0 )
+	{
+		return;
+	}
+
+	std::memcpy(Min.data(), Source.data(), Min.size_bytes());
+	std::memcpy(Max.data(), Source.data(), Max.size_bytes());
+
+	std::size_t VertexIdx = 1;
+#if defined(TSUHAN_SSE2)
+	VertexIdx = FloatBoundsSSE2(Source, SourceStride, VertexCount, Min, Max);
+#endif
+
+	for( ; VertexIdx < VertexCount; ++VertexIdx )
+	{
+		const auto* CurSource = reinterpret_cast<const float*>(
+			Source.data() + VertexIdx * SourceStride
+		);
+		for( std::size_t i = 0; i < Min.size(); ++i )
+		{
+			Min[i] = std::min(Min[i], CurSource[i]);
+			Max[i] = std::max(Max[i], CurSource[i]);
+		}
+	}
+}
+
+} // namespace TsuHan
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace TsuHan
+{
+
+// Bulk conversions of interleaved vertex attributes. `Source` and `Dest`
+// start at the attribute within the first vertex and each stride is the
+// size of a vertex within its buffer. The bounds of the converted values
+// are written to `Min`/`Max`, which are only meaningful if `VertexCount` is
+// not 0.
+
+// Copies `AttributeSize` bytes of each vertex as-is
+void CopyVertices(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::size_t AttributeSize
+);
+
+// Converts float positions onto a grid of int16s such that
+// `Position = Offset + Quantized * Scale`
+void QuantizePositions(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<const float, 3> Offset, float Scale,
+	std::span<std::int16_t, 3> Min, std::span<std::int16_t, 3> Max
+);
+
+// Converts float normals into unit-length snorm8s
+void QuantizeNormals(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::int8_t, 3> Min, std::span<std::int8_t, 3> Max
+);
+
+// Converts three-component float tangents into unit-length snorm8s. The
+// handedness is not stored in the source and is always written as +1.
+void QuantizeTangents(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::int8_t, 4> Min, std::span<std::int8_t, 4> Max
+);
+
+// Converts float colors into unorm8s, clamping them to [0, 1]
+void QuantizeColors(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint8_t, 4> Min, std::span<std::uint8_t, 4> Max
+);
+
+// Converts float texture coordinates into unorm16s, clamping them to [0, 1]
+void QuantizeTexCoords(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint16_t, 2> Min, std::span<std::uint16_t, 2> Max
+);
+
+// Converts `WeightCount` float skin weights per vertex into four unorm8
+// weights that sum to exactly 255. Vertices without any weight are bound
+// entirely to their first joint.
+void QuantizeWeights(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::size_t WeightCount, std::span<std::uint8_t, 4> Min,
+	std::span<std::uint8_t, 4> Max
+);
+
+// Converts four integer-valued float joint indices per vertex into uint16s
+void QuantizeJoints(
+	std::span<const std::byte> Source, std::span<std::byte> Dest,
+	std::size_t SourceStride, std::size_t DestStride, std::size_t VertexCount,
+	std::span<std::uint16_t, 4> Min, std::span<std::uint16_t, 4> Max
+);
+
+// Finds the bounds of each of the first `Min.size()` floats of a vertex,
+// over all vertices in a single pass. `Max` is the same size as `Min`, and
+// neither is written if `VertexCount` is 0.
+void FloatBounds(
+	std::span<const std::byte> Source, std::size_t SourceStride,
+	std::size_t VertexCount, std::span<float> Min, std::span<float> Max
+);
+
+} // namespace TsuHan
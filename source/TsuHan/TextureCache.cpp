@@ -0,0 +1,241 @@
+#include <TsuHan/TextureCache.hpp>
+
+#include <TsuHan/Trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include "BlockCompress.hpp"
+#include "Hash.hpp"
+#include "Image.hpp"
+#include "KTX2.hpp"
+
+#include <mio/mmap.hpp>
+
+namespace TsuHan
+{
+
+namespace
+{
+
+// Value of `Key` in `Cache`, which is made on first use. Threads that ask
+// for a value that is still being made wait for it. Values that failed to be
+// made keep failing, so their error is kept too.
+template<typename T, typename MakeProc>
+T GetOrMake(
+	std::mutex& Mutex,
+	std::unordered_map<const TextureCache::Image*, std::shared_future<T>>&
+		Cache,
+	const TextureCache::Image* Key, MakeProc&& Make
+)
+{
+	std::promise<T>       Made;
+	std::shared_future<T> Pending;
+	{
+		const std::scoped_lock Lock(Mutex);
+		const auto [Found, Inserted] = Cache.try_emplace(Key);
+		if( Inserted )
+		{
+			Found->second = Made.get_future().share();
+		}
+		else
+		{
+			Pending = Found->second;
+		}
+	}
+
+	// Made or being made by another thread
+	if( Pending.valid() )
+	{
+		return Pending.get();
+	}
+
+	// Made outside of the lock so that other values can be made meanwhile
+	try
+	{
+		T Result = Make();
+		Made.set_value(Result);
+		return Result;
+	}
+	catch( ... )
+	{
+		Made.set_exception(std::current_exception());
+		throw;
+	}
+}
+
+} // namespace
+
+TextureCache::ImageData TextureCache::Load(const std::filesystem::path& Path)
+{
+	const std::string Key
+		= std::filesystem::absolute(Path).lexically_normal().string();
+
+	std::promise<ImageData>       Loaded;
+	std::shared_future<ImageData> Pending;
+	{
+		const std::scoped_lock Lock(Mutex);
+		const auto [Found, Inserted] = Files.try_emplace(Key);
+		if( Inserted )
+		{
+			Found->second = Loaded.get_future().share();
+		}
+		else
+		{
+			Pending = Found->second;
+		}
+	}
+
+	// Loaded or being loaded by another thread
+	if( Pending.valid() )
+	{
+		return Pending.get();
+	}
+
+	// Loaded outside of the lock so that other files can load meanwhile
+	try
+	{
+		const auto MappedFile = mio::mmap_source(Key);
+
+		std::vector<std::byte> Data(MappedFile.size());
+		std::memcpy(Data.data(), MappedFile.data(), Data.size());
+
+		const ImageData Result = Intern(std::move(Data));
+		Loaded.set_value(Result);
+		return Result;
+	}
+	catch( ... )
+	{
+		{
+			const std::scoped_lock Lock(Mutex);
+			Files.erase(Key);
+		}
+		Loaded.set_exception(std::current_exception());
+		throw;
+	}
+}
+
+TextureCache::ImageData TextureCache::GetPNG(const ImageData& Source)
+{
+	return GetOrMake(Mutex, PNGs, Source.get(), [&]() {
+		std::vector<std::byte> Data = EncodePNG(DecodeTGA(Source->Data));
+
+		const std::uint64_t Hash = HashBytes(Data);
+		return ImageData(
+			std::make_shared<Image>(Image{Hash, std::move(Data)})
+		);
+	});
+}
+
+AlphaCoverage TextureCache::GetAlphaCoverage(const ImageData& Source)
+{
+	return GetOrMake(Mutex, AlphaCoverages, Source.get(), [&]() {
+		return ClassifyAlpha(DecodeTGA(Source->Data));
+	});
+}
+
+std::filesystem::path TextureCache::GetKTX2(
+	const ImageData& Source, const std::filesystem::path& Path,
+	bool KaiserMips, ThreadPool* Pool
+)
+{
+	return GetOrMake(Mutex, KTX2s, Source.get(), [&]() {
+		using Clock      = std::chrono::steady_clock;
+		using Duration   = std::chrono::duration<double, std::milli>;
+		const auto Start = Clock::now();
+
+		const Bitmap Decoded = DecodeTGA(Source->Data);
+
+		// Alpha is only kept if any of it is below 255
+		const BlockFormat Format
+			= ClassifyAlpha(Decoded) == AlphaCoverage::Opaque
+				? BlockFormat::BC1
+				: BlockFormat::BC3;
+
+		std::vector<Bitmap> Mips;
+		Mips.push_back(ToRGBA(Decoded));
+
+		const MipFilter Filter
+			= KaiserMips ? MipFilter::Kaiser : MipFilter::Box;
+		while( Mips.back().Width > 1 || Mips.back().Height > 1 )
+		{
+			Mips.push_back(Downsample(Mips.back(), Filter));
+		}
+		const auto MipsDone = Clock::now();
+
+		std::vector<std::vector<std::byte>> Levels;
+		for( const Bitmap& CurMip : Mips )
+		{
+			Levels.push_back(CompressBlocks(CurMip, Format, Pool));
+		}
+		const auto BlocksDone = Clock::now();
+
+		const std::vector<std::byte> Data = EncodeKTX2(
+			Format, Mips.front().Width, Mips.front().Height, Levels
+		);
+
+		std::ofstream OutFile(Path, std::ios::binary);
+		OutFile.write(
+			reinterpret_cast<const char*>(Data.data()), Data.size()
+		);
+		if( !OutFile )
+		{
+			throw std::runtime_error(
+				"Unable to write " + Path.filename().string()
+			);
+		}
+
+		TSUHAN_TRACE(
+			Info,
+			"\t%s: %ux%u %s, %zu levels, mips %.2f ms, blocks %.2f ms, "
+			"total %.2f ms\n",
+			Path.filename().string().c_str(), Mips.front().Width,
+			Mips.front().Height, Format == BlockFormat::BC3 ? "BC3" : "BC1",
+			Mips.size(), Duration(MipsDone - Start).count(),
+			Duration(BlocksDone - MipsDone).count(),
+			Duration(Clock::now() - Start).count()
+		);
+
+		return Path;
+	});
+}
+
+std::size_t TextureCache::GetFileCount() const
+{
+	const std::scoped_lock Lock(Mutex);
+	return Files.size();
+}
+
+std::size_t TextureCache::GetImageCount() const
+{
+	const std::scoped_lock Lock(Mutex);
+	return Images.size();
+}
+
+TextureCache::ImageData TextureCache::Intern(std::vector<std::byte>&& Data)
+{
+	const std::uint64_t Hash = HashBytes(Data);
+
+	const std::scoped_lock Lock(Mutex);
+
+	// Images with the same hash are compared in full
+	const auto [First, Last] = Images.equal_range(Hash);
+	for( auto CurImage = First; CurImage != Last; ++CurImage )
+	{
+		if( std::ranges::equal(CurImage->second->Data, Data) )
+		{
+			return CurImage->second;
+		}
+	}
+
+	auto NewImage = std::make_shared<Image>(Image{Hash, std::move(Data)});
+	Images.emplace(Hash, NewImage);
+	return NewImage;
+}
+
+} // namespace TsuHan
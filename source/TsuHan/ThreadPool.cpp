@@ -0,0 +1,199 @@
+#include <TsuHan/ThreadPool.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace TsuHan
+{
+
+namespace
+{
+// Pool and queue-index of the worker running on the current thread
+thread_local const ThreadPool* CurrentPool        = nullptr;
+thread_local std::size_t       CurrentWorkerIndex = 0;
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t ThreadCount)
+{
+	if( ThreadCount == 0 )
+	{
+		ThreadCount = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	Queues.reserve(ThreadCount);
+	for( std::size_t i = 0; i < ThreadCount; ++i )
+	{
+		Queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	Workers.reserve(ThreadCount);
+	for( std::size_t i = 0; i < ThreadCount; ++i )
+	{
+		Workers.emplace_back(&ThreadPool::WorkerMain, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		const std::lock_guard Lock(SleepMutex);
+		Stopping = true;
+	}
+	WorkAvailable.notify_all();
+
+	for( std::thread& CurWorker : Workers )
+	{
+		CurWorker.join();
+	}
+}
+
+std::size_t ThreadPool::GetThreadCount() const
+{
+	return Workers.size();
+}
+
+void ThreadPool::Submit(TaskGroup& Group, std::function<void()> Proc)
+{
+	Group.Pending.fetch_add(1);
+
+	const std::size_t QueueIndex
+		= (CurrentPool == this)
+			? CurrentWorkerIndex
+			: NextQueue.fetch_add(1, std::memory_order_relaxed) % Queues.size();
+
+	{
+		WorkerQueue&          Queue = *Queues[QueueIndex];
+		const std::lock_guard Lock(Queue.Mutex);
+		Queue.Tasks.push_back({std::move(Proc), &Group});
+	}
+
+	{
+		const std::lock_guard Lock(SleepMutex);
+		QueuedCount.fetch_add(1);
+		Group.Queued.fetch_add(1);
+	}
+	WorkAvailable.notify_one();
+
+	// Threads waiting on the group help with its new task
+	TaskFinished.notify_all();
+}
+
+void ThreadPool::Wait(TaskGroup& Group)
+{
+	const std::size_t PreferredQueue
+		= (CurrentPool == this) ? CurrentWorkerIndex : 0;
+
+	while( Group.Pending.load() != 0 )
+	{
+		if( Task CurTask; TryGetTask(PreferredQueue, CurTask, &Group) )
+		{
+			RunTask(CurTask);
+			continue;
+		}
+
+		// Nothing left to help with, sleep until one of the remaining tasks
+		// finishes or more work of the group shows up
+		std::unique_lock Lock(SleepMutex);
+		TaskFinished.wait(Lock, [&] {
+			return Group.Pending.load() == 0 || Group.Queued.load() != 0;
+		});
+	}
+
+	const std::lock_guard Lock(Group.ErrorMutex);
+	if( Group.Error )
+	{
+		std::rethrow_exception(std::exchange(Group.Error, nullptr));
+	}
+}
+
+bool ThreadPool::TryPop(
+	std::size_t QueueIndex, Task& Result, const TaskGroup* Group
+)
+{
+	WorkerQueue&          Queue = *Queues[QueueIndex];
+	const std::lock_guard Lock(Queue.Mutex);
+
+	// Oldest task, of the group if there is one
+	const auto Found = std::find_if(
+		Queue.Tasks.begin(), Queue.Tasks.end(),
+		[Group](const Task& CurTask) {
+			return !Group || CurTask.Group == Group;
+		}
+	);
+	if( Found == Queue.Tasks.end() )
+	{
+		return false;
+	}
+
+	Result = std::move(*Found);
+	Queue.Tasks.erase(Found);
+	QueuedCount.fetch_sub(1);
+	Result.Group->Queued.fetch_sub(1);
+	return true;
+}
+
+bool ThreadPool::TryGetTask(
+	std::size_t PreferredQueue, Task& Result, const TaskGroup* Group
+)
+{
+	// Own queue first, then steal from the others
+	for( std::size_t i = 0; i < Queues.size(); ++i )
+	{
+		if( TryPop((PreferredQueue + i) % Queues.size(), Result, Group) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::RunTask(Task& CurTask)
+{
+	try
+	{
+		CurTask.Proc();
+	}
+	catch( ... )
+	{
+		const std::lock_guard Lock(CurTask.Group->ErrorMutex);
+		if( !CurTask.Group->Error )
+		{
+			CurTask.Group->Error = std::current_exception();
+		}
+	}
+
+	if( CurTask.Group->Pending.fetch_sub(1) == 1 )
+	{
+		// Taking the lock ensures a waiter cannot miss this notification
+		// between checking its predicate and going to sleep
+		const std::lock_guard Lock(SleepMutex);
+		TaskFinished.notify_all();
+	}
+}
+
+void ThreadPool::WorkerMain(std::size_t WorkerIndex)
+{
+	CurrentPool        = this;
+	CurrentWorkerIndex = WorkerIndex;
+
+	while( true )
+	{
+		if( Task CurTask; TryGetTask(WorkerIndex, CurTask) )
+		{
+			RunTask(CurTask);
+			continue;
+		}
+
+		std::unique_lock Lock(SleepMutex);
+		WorkAvailable.wait(Lock, [&] {
+			return Stopping || QueuedCount.load() != 0;
+		});
+
+		if( Stopping && QueuedCount.load() == 0 )
+		{
+			return;
+		}
+	}
+}
+
+} // namespace TsuHan
@@ -0,0 +1,99 @@
+#include <TsuHan/Trace.hpp>
+
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+namespace TsuHan
+{
+
+std::atomic<TraceLevel> Detail::CurrentTraceLevel = TraceLevel::None;
+
+namespace
+{
+// Buffers are written out once they reach this size
+constexpr std::size_t TraceFlushSize = 16 * 1024;
+
+struct TraceBuffer
+{
+	std::string Data;
+
+	TraceBuffer()
+	{
+		Data.reserve(TraceFlushSize + 1024);
+	}
+
+	~TraceBuffer()
+	{
+		Flush();
+	}
+
+	void Flush()
+	{
+		if( Data.empty() )
+		{
+			return;
+		}
+
+		// A single write keeps the whole buffer together in the output
+		std::fwrite(Data.data(), 1, Data.size(), stdout);
+		std::fflush(stdout);
+		Data.clear();
+	}
+};
+
+thread_local TraceBuffer CurrentTraceBuffer;
+} // namespace
+
+void SetTraceLevel(TraceLevel Level)
+{
+	Detail::CurrentTraceLevel.store(Level, std::memory_order_relaxed);
+}
+
+void Detail::TraceWrite(const char* Format, ...)
+{
+	std::string& Buffer = CurrentTraceBuffer.Data;
+
+	va_list Args;
+	va_start(Args, Format);
+	va_list ArgsRetry;
+	va_copy(ArgsRetry, Args);
+
+	// Format straight into the spare capacity of the buffer and only format
+	// a second time if it did not fit
+	const std::size_t PrevSize  = Buffer.size();
+	const std::size_t SpareSize = Buffer.capacity() - PrevSize;
+	Buffer.resize(Buffer.capacity());
+
+	const int Length
+		= std::vsnprintf(Buffer.data() + PrevSize, SpareSize + 1, Format, Args);
+	va_end(Args);
+
+	if( Length < 0 )
+	{
+		Buffer.resize(PrevSize);
+		va_end(ArgsRetry);
+		return;
+	}
+
+	if( static_cast<std::size_t>(Length) > SpareSize )
+	{
+		Buffer.resize(PrevSize + Length);
+		std::vsnprintf(Buffer.data() + PrevSize, Length + 1, Format, ArgsRetry);
+	}
+	va_end(ArgsRetry);
+
+	Buffer.resize(PrevSize + Length);
+
+	if( Buffer.size() >= TraceFlushSize )
+	{
+		CurrentTraceBuffer.Flush();
+	}
+}
+
+void FlushTrace()
+{
+	CurrentTraceBuffer.Flush();
+}
+
+} // namespace TsuHan
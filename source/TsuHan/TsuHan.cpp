@@ -1,10 +1,22 @@
+#include <TsuHan/TextureCache.hpp>
+#include <TsuHan/ThreadPool.hpp>
+#include <TsuHan/Trace.hpp>
 #include <TsuHan/TsuHan.hpp>
 
-#include <cstdarg>
+#include <cmath>
 #include <cstring>
+#include <limits>
+#include <map>
+#include <optional>
 #include <regex>
 #include <string_view>
+#include <unordered_set>
 
+#include "Atlas.hpp"
+#include "GLTFWriter.hpp"
+#include "Image.hpp"
+#include "IndexBuffer.hpp"
+#include "Quantize.hpp"
 #include "tiny_gltf.h"
 
 #include <mio/mmap.hpp>
@@ -12,6 +24,7 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/range.hpp>
 
@@ -68,104 +81,193 @@ std::size_t GetVertexBufferStride(std::uint16_t VertexAttributeMask)
 	return Result;
 }
 
-std::span<const std::byte>
-	ReadFormattedBytes(std::span<const std::byte> Bytes, const char* Format...)
+std::string_view Detail::ReadString(std::span<const std::byte>& Bytes)
 {
-	va_list Args;
-	va_start(Args, Format);
-
-	for( const char& Token : std::string_view(Format) )
+	const void* Terminator = std::memchr(Bytes.data(), 0, Bytes.size());
+	if( Terminator == nullptr )
 	{
-		if( Bytes.empty() )
-		{
-			return Bytes;
-		}
+		throw std::out_of_range("Unterminated string in chunk");
+	}
 
-		switch( std::tolower(Token) )
-		{
-		case 's':
-		{
-			const std::size_t StringLength
-				= std::strlen((const char*)Bytes.data());
+	const std::size_t StringLength
+		= static_cast<const std::byte*>(Terminator) - Bytes.data();
 
-			const std::size_t StringLengthAligned = 4 * (StringLength / 4) + 4;
+	const std::size_t StringLengthAligned = 4 * (StringLength / 4) + 4;
+	if( StringLengthAligned > Bytes.size() )
+	{
+		throw std::out_of_range("Chunk field exceeds chunk size");
+	}
 
-			char* Value = va_arg(Args, char*);
+	const std::string_view Result(
+		reinterpret_cast<const char*>(Bytes.data()), StringLength
+	);
+	Bytes = Bytes.subspan(StringLengthAligned);
+	return Result;
+}
 
-			std::memcpy(Value, Bytes.data(), StringLengthAligned);
+namespace
+{
+void TraceField(std::string_view String)
+{
+	TsuHan::Detail::TraceWrite(
+		"\t %%s \'%.*s\'\n", (std::uint32_t)String.size(), String.data()
+	);
+}
 
-			Bytes = Bytes.subspan(StringLengthAligned);
-			break;
-		}
-		case 'l':
-		case 'f':
-		{
-			std::uint32_t* Value = va_arg(Args, std::uint32_t*);
-			std::memcpy(Value, Bytes.data(), sizeof(std::uint32_t));
+void TraceField(std::uint32_t Integer)
+{
+	TsuHan::Detail::TraceWrite("\t %%l %d(0x%08x)\n", Integer, Integer);
+}
 
-			Bytes = Bytes.subspan(sizeof(std::uint32_t));
-			break;
-		}
-		default:
-		{
-			break;
-		}
-		}
+void TraceField(float Float)
+{
+	TsuHan::Detail::TraceWrite("\t %%f %f\n", Float);
+}
+
+template<typename... T>
+void TraceFields(const std::tuple<T...>& Fields)
+{
+	if( !IsTraceEnabled<TraceLevel::Verbose>() )
+	{
+		return;
 	}
-	va_end(Args);
 
-	return Bytes;
+	std::apply([](const T&... Field) { (TraceField(Field), ...); }, Fields);
 }
 
-namespace
-{
-std::span<const std::byte>
-	PrintFormattedBytes(std::span<const std::byte> Bytes, const char* Format)
+// Vertex attributes, in the order of a geometry's accessor indices after
+// its index accessor
+constexpr std::array<const char*, 7> VertexAttributeNames = {
+	"POSITION",   // VertexPositionAccessorIdx
+	"NORMAL",     // VertexNormalAccessorIdx
+	"TANGENT",    // VertexTangentAccessorIdx
+	"COLOR_0",    // VertexColorAccessorIdx
+	"WEIGHTS_0",  // VertexWeightsAccessorIdx
+	"JOINTS_0",   // VertexJointsAccessorIdx
+	"TEXCOORD_0", // VertexTexCoordAccessorIdx
+};
+
+// Keys of the vertices for welding. Holds the exported attributes of each
+// vertex, with every float snapped onto a grid of `Epsilon` unless it is 0.
+// Empty if no attribute is exported.
+std::vector<std::uint32_t> GetWeldKeys(
+	std::span<const std::byte> VertexData, std::size_t VertexCount,
+	std::uint16_t VertexAttributeMask, float Epsilon
+)
 {
-	for( const char& Token : std::string_view(Format) )
+	// Position, Normal, Tangent, Color, Weights, Joints, TexCoord
+	const std::uint16_t ExportedMask
+		= VertexAttributeMask & 0b0001'1'1111'01'0111;
+
+	// Byte-offsets of the exported floats within a vertex
+	std::vector<std::size_t> FloatOffsets;
+	for( std::uint8_t i = 0; i < 16; ++i )
 	{
-		if( Bytes.empty() )
+		const std::uint16_t AttribMask = 1U << i;
+		if( !(ExportedMask & AttribMask) )
 		{
-			return Bytes;
+			continue;
 		}
 
-		switch( std::tolower(Token) )
+		const std::size_t AttributeOffset
+			= GetVertexBufferStride((AttribMask - 1) & VertexAttributeMask);
+		const std::size_t AttributeSize = GetVertexBufferStride(AttribMask);
+		for( std::size_t j = 0; j < AttributeSize; j += sizeof(float) )
 		{
-		case 's':
-		{
-			const std::size_t StringLength
-				= std::strlen((const char*)Bytes.data());
-
-			const std::size_t StringLengthAligned = 4 * (StringLength / 4) + 4;
+			FloatOffsets.push_back(AttributeOffset + j);
+		}
+	}
 
-			char String[256];
-			std::memcpy(String, Bytes.data(), StringLengthAligned);
+	std::vector<std::uint32_t> Result;
+	if( FloatOffsets.empty() )
+	{
+		return Result;
+	}
+	Result.reserve(VertexCount * FloatOffsets.size());
 
-			std::printf(
-				"\t %%s \'%.*s\'\n", (std::uint32_t)StringLength, String
-			);
-			Bytes = Bytes.subspan(StringLengthAligned);
-			break;
-		}
-		case 'l':
+	const std::size_t VertexStride = GetVertexBufferStride(VertexAttributeMask);
+	for( std::size_t VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx )
+	{
+		const std::byte* CurVertex
+			= VertexData.data() + VertexIdx * VertexStride;
+		for( const std::size_t CurOffset : FloatOffsets )
 		{
-			std::uint32_t Integer;
-			std::memcpy(&Integer, Bytes.data(), sizeof(std::uint32_t));
-			std::printf("\t %%l %d(0x%08x)\n", Integer, Integer);
-			Bytes = Bytes.subspan(sizeof(std::uint32_t));
-			break;
+			float CurFloat;
+			std::memcpy(&CurFloat, CurVertex + CurOffset, sizeof(float));
+
+			std::uint32_t CurKey;
+			if( Epsilon > 0.0f )
+			{
+				CurKey = static_cast<std::uint32_t>(
+					std::lround(CurFloat / Epsilon)
+				);
+			}
+			else
+			{
+				// -0.0 and 0.0 are the same value
+				CurFloat += 0.0f;
+				std::memcpy(&CurKey, &CurFloat, sizeof(float));
+			}
+			Result.push_back(CurKey);
 		}
-		case 'f':
+	}
+
+	return Result;
+}
+
+// Joints that influence each vertex, four per vertex. A joint is -1 if its
+// weight is 0, though a vertex without any weight is bound to its first
+// joint. Empty if the vertices have no joints.
+std::vector<std::int32_t> GetVertexJoints(
+	std::span<const std::byte> VertexData, std::size_t VertexCount,
+	std::uint16_t VertexAttributeMask
+)
+{
+	const std::uint16_t JointMask = VertexAttributeMask & 0b0000'1'0000'00'0000;
+	const std::uint16_t WeightMask
+		= VertexAttributeMask & 0b0000'0'1111'00'0000;
+	const std::size_t WeightCount = std::popcount(WeightMask);
+
+	std::vector<std::int32_t> Result;
+	if( !JointMask )
+	{
+		return Result;
+	}
+	Result.reserve(VertexCount * 4);
+
+	const std::size_t VertexStride = GetVertexBufferStride(VertexAttributeMask);
+	const std::size_t JointOffset
+		= GetVertexBufferStride((JointMask - 1) & VertexAttributeMask);
+	const std::size_t WeightOffset = GetVertexBufferStride(
+		((-WeightMask & WeightMask) - 1) & VertexAttributeMask
+	);
+
+	for( std::size_t VertexIdx = 0; VertexIdx < VertexCount; ++VertexIdx )
+	{
+		const std::byte* CurVertex
+			= VertexData.data() + VertexIdx * VertexStride;
+
+		std::array<float, 4> Joints;
+		std::array<float, 4> Weights = {};
+		std::memcpy(Joints.data(), CurVertex + JointOffset, sizeof(Joints));
+		std::memcpy(
+			Weights.data(), CurVertex + WeightOffset,
+			WeightCount * sizeof(float)
+		);
+
+		const bool Unweighted = std::ranges::none_of(Weights, [](float Weight) {
+			return Weight > 0.0f;
+		});
+		for( std::size_t i = 0; i < 4; ++i )
 		{
-			float Float;
-			std::memcpy(&Float, Bytes.data(), sizeof(float));
-			std::printf("\t %%f %f\n", Float);
-			Bytes = Bytes.subspan(sizeof(float));
-			break;
-		}
+			const bool Used = Weights[i] > 0.0f || (Unweighted && i == 0);
+			Result.push_back(
+				Used ? static_cast<std::int32_t>(Joints[i]) : -1
+			);
 		}
 	}
-	return Bytes;
+
+	return Result;
 }
 
 template<class ForwardIt>
@@ -186,38 +288,19 @@ ForwardIt max_element_nth(ForwardIt first, ForwardIt last, int n)
 	}
 	return largest;
 }
-
-template<typename T>
-void AccessorMinMax(
-	std::span<const std::byte>  VertexData,
-	const tinygltf::BufferView& VertexBufferView, tinygltf::Accessor& Accessor
-)
-{
-	// Offset to vertex attribute
-	VertexData = VertexData.subspan(Accessor.byteOffset);
-	T CurMin   = *reinterpret_cast<const T*>(VertexData.data());
-	T CurMax   = *reinterpret_cast<const T*>(VertexData.data());
-
-	for( std::size_t VertexIdx = 1; VertexIdx < Accessor.count; ++VertexIdx )
-	{
-		const T& CurElement = *reinterpret_cast<const T*>(
-			VertexData.data() + VertexIdx * VertexBufferView.byteStride
-		);
-
-		CurMin = glm::min(CurMin, CurElement);
-		CurMax = glm::max(CurMax, CurElement);
-	}
-
-	Accessor.minValues.assign(glm::begin(CurMin), glm::end(CurMin));
-	Accessor.maxValues.assign(glm::begin(CurMax), glm::end(CurMax));
-}
 } // namespace
 
 class GLTFConverter final : public HGMVisitor
 {
+	const GLTFOptions Options;
+
 	tinygltf::Asset GLTFAsset = {};
 	tinygltf::Model GLTFModel = {};
 
+	// Vertex, index and image data is streamed straight out to the file,
+	// the model itself only holds metadata
+	GLTFWriter Writer;
+
 	std::unordered_map<std::string, std::array<std::int32_t, 16>> GeometryLUT;
 	std::unordered_map<std::string, std::uint32_t>                MeshLUT;
 	std::unordered_map<std::string, std::uint32_t>                MaterialLUT;
@@ -225,8 +308,134 @@ class GLTFConverter final : public HGMVisitor
 	std::unordered_map<std::string, std::uint32_t>                TextureLUT;
 	std::unordered_map<std::string, std::uint32_t>                TransformLUT;
 
+	// Texture files are looked up next to the HGM, in the "texture"
+	// directory that mirrors its "model" directory
+	std::filesystem::path TexturePath;
+	TextureCache          LocalTextures;
+	TextureCache*         Textures;
+
+	// Image of each distinct texture image, which textures with identical
+	// contents share
+	std::unordered_map<const TextureCache::Image*, std::uint32_t> ImageLUT;
+
+	// Alpha coverage of the image of each visited texture, by index
+	std::unordered_map<std::uint32_t, AlphaCoverage> TextureCoverageLUT;
+
+	// Region of an atlas page that a packed texture was placed in, in
+	// texture coordinates
+	struct AtlasRegion
+	{
+		std::uint32_t        Page;
+		std::array<float, 2> Offset;
+		std::array<float, 2> Scale;
+		AlphaCoverage        Coverage;
+	};
+
+	std::unordered_map<std::string, AtlasRegion> AtlasLUT;
+	std::vector<Bitmap>                          AtlasPages;
+
+	// Texture of each atlas page, once a material uses it
+	std::vector<std::int32_t> AtlasPageTextures;
+
+	// Image of each baked KTX2 file, by its URI
+	std::unordered_map<std::string, std::uint32_t> KTX2LUT;
+
+	// A buffer view that has yet to be added to the model
+	struct PendingBufferView
+	{
+		tinygltf::BufferView       BufferView;
+		std::vector<std::byte>     Storage; // For data that was re-encoded
+		std::span<const std::byte> Data;
+	};
+
+	// A range of a geometry's indices whose vertices use at most
+	// `Options.MaxSkinJoints` joints, renumbered into the partition's palette
+	struct GeometryPartition
+	{
+		std::int32_t               IndexAccessorIdx;
+		std::vector<std::uint16_t> Joints; // Source joint of each joint
+	};
+
+	// Partitions of each geometry, and the skin of each partition of each
+	// submesh's material and geometry
+	std::unordered_map<std::string, std::vector<GeometryPartition>>
+		PartitionLUT;
+	std::map<std::pair<std::string, std::string>, std::vector<std::int32_t>>
+		PartitionSkinLUT;
+
+	// Geometry that has yet to be added to the model. Accessors refer to
+	// the geometry's own buffer views, and its accessor indices to its own
+	// accessors.
+	struct ConvertedGeometry
+	{
+		std::string                     Name;
+		std::vector<PendingBufferView>  BufferViews;
+		std::vector<tinygltf::Accessor> Accessors;
+		std::array<std::int32_t, 16>    AccessorIndices;
+
+		// Skin partitions, if the geometry uses more than
+		// `Options.MaxSkinJoints` joints
+		std::vector<GeometryPartition> Partitions;
+	};
+
+	std::unordered_map<const std::byte*, std::optional<ConvertedGeometry>>
+		PreparedGeometry;
+
+	// Quantized positions of all geometry share a single grid, such that
+	// `Position = Offset + Quantized * Scale`
+	struct QuantizationGrid
+	{
+		std::array<float, 3> Offset = {};
+		float                Scale  = 1.0f;
+	};
+
+	QuantizationGrid PositionGrid;
+
+	// Node of each mesh-node that holds its dequantization transform
+	std::unordered_map<std::uint32_t, std::uint32_t> DequantizeLUT;
+
+	// When batching, meshes are only built once the whole scene is known.
+	// Geometry is held back until a mesh that is not batched uses it.
+	struct Submesh
+	{
+		std::string MaterialName;
+		std::string GeometryName;
+	};
+
+	struct PendingMesh
+	{
+		std::string                Name;
+		std::vector<Submesh>       Submeshes;
+		std::vector<std::uint32_t> Nodes; // Nodes the mesh is attached to
+	};
+
+	std::vector<PendingMesh>                           PendingMeshes;
+	std::unordered_map<std::string, ConvertedGeometry> PendingGeometry;
+
+	// Static submeshes of a material, merged into a single primitive in
+	// world space
+	struct Batch
+	{
+		// Accessors of the first geometry, for the layout of the vertices
+		std::array<std::optional<tinygltf::Accessor>, 7> Attributes;
+
+		std::size_t                Stride = 0;
+		std::vector<std::byte>     Vertices;
+		std::vector<std::uint16_t> Indices;
+
+		// Range of the indices and vertices of each submesh
+		tinygltf::Value::Array Ranges;
+	};
+
 public:
-	GLTFConverter(const std::filesystem::path& HGMPath) : HGMVisitor(HGMPath)
+	GLTFConverter(
+		const std::filesystem::path& HGMPath, const GLTFOptions& ConvertOptions
+	)
+		: HGMVisitor(HGMPath), Options(ConvertOptions),
+		  TexturePath(std::regex_replace(
+			  HGMPath.string(), std::regex("model"), "texture"
+		  )),
+		  Textures(Options.Textures ? Options.Textures : &LocalTextures)
 	{
 		GLTFAsset.generator = "TsuHanTools:" __TIMESTAMP__;
 		GLTFAsset.version   = "2.0";
@@ -238,384 +447,562 @@ public:
 			// Unlit not needed
 		};
 
+		if( Options.BakeTextures )
+		{
+			// Optional, the embedded images remain as the fallback
+			GLTFModel.extensionsUsed.push_back("KHR_texture_basisu");
+		}
+
+		if( Options.Quantize )
+		{
+			GLTFModel.extensionsUsed.push_back("KHR_mesh_quantization");
+			GLTFModel.extensionsRequired.push_back("KHR_mesh_quantization");
+		}
+
 		tinygltf::Scene GLTFScene;
 		GLTFScene.name = FilePath.filename();
 		GLTFScene.nodes.push_back(0);
 
 		GLTFModel.scenes.push_back(GLTFScene);
+
+		// All geometry and image data is written to a single buffer
+		tinygltf::Buffer GLTFBuffer;
+		GLTFBuffer.name = FilePath.filename().string() + ": Buffer";
+		GLTFModel.buffers.push_back(GLTFBuffer);
 	}
 
 	void BeginHGM() override{};
 	void EndHGM() override
 	{
+		if( Options.Batch )
+		{
+			BuildBatches();
+		}
+
 		std::filesystem::path DestPath = FilePath;
-		DestPath                       = DestPath.replace_extension(".gltf");
+		DestPath.replace_extension(Options.Binary ? ".glb" : ".gltf");
+
+		GLTFModel.asset = GLTFAsset;
 
 		// Save it to a file
-		tinygltf::TinyGLTF gltf;
-		gltf.WriteGltfSceneToFile(
-			&GLTFModel, DestPath.string(),
-			true, // embedImages
-			true, // embedBuffers
-			true, // pretty print
-			false // write binary
+		Writer.Finish(
+			GLTFModel, DestPath.string(),
+			Options.Binary, // write binary
+			!Options.Binary // pretty print
 		);
 	}
 
-	void VisitGeometry(std::span<const std::byte> Data) override
+	// Adds a buffer view whose data is to be written with WriteBufferView
+	std::int32_t AddBufferView(
+		const std::string& Name, std::size_t ByteStride = 0,
+		std::int32_t Target = 0
+	)
 	{
-		// slllllll
-		struct GeometryHeader
-		{
-			char          Name[256] = {};
-			float         UnknownA;
-			float         UnknownB;
-			float         UnknownC;
-			float         UnknownD;
-			std::uint32_t UnknownE; // UnknownFlag
-			std::uint32_t VertexAttributeMask;
-
-			// Not sure what this indicates but when non-zero then it skips
-			// loading all geometry data from the file.
-			std::uint32_t UnknownSkip;
-		} Header;
-		PrintFormattedBytes(Data, "sfffflll");
-		Data = ReadFormattedBytes(
-			Data, "sfffflll", Header.Name, &Header.UnknownA, &Header.UnknownB,
-			&Header.UnknownC, &Header.UnknownD, &Header.UnknownE,
-			&Header.VertexAttributeMask, &Header.UnknownSkip
-		);
+		tinygltf::BufferView NewBufferView;
+		NewBufferView.name       = Name;
+		NewBufferView.buffer     = 0;
+		NewBufferView.byteStride = ByteStride;
+		NewBufferView.target     = Target;
+		GLTFModel.bufferViews.push_back(NewBufferView);
+
+		return GLTFModel.bufferViews.size() - 1;
+	}
 
-		if( Header.UnknownSkip != 0U )
-		{
-			return;
-		}
+	// Streams the data of a buffer view out to the model's buffer
+	void WriteBufferView(
+		std::int32_t BufferViewIdx, std::span<const std::byte> Data
+	)
+	{
+		// Keep every view aligned for the accessors within it
+		constexpr std::size_t BufferViewAlignment = 16;
 
-		std::uint32_t VertexCount;
-		PrintFormattedBytes(Data, "l");
-		Data = ReadFormattedBytes(Data, "l", &VertexCount);
-		const std::size_t VertexDataSize
-			= GetVertexBufferStride(Header.VertexAttributeMask) * VertexCount;
+		tinygltf::BufferView& CurBufferView
+			= GLTFModel.bufferViews[BufferViewIdx];
+		CurBufferView.byteOffset = Writer.Write(Data, BufferViewAlignment);
+		CurBufferView.byteLength = Data.size();
+	}
 
-		// Vertex data
-		const std::span<const std::byte> VertexData
-			= Data.first(VertexDataSize);
+	// Fits the position grid around the positions of every geometry chunk.
+	// One grid for the whole model keeps meshes lined up with each other and
+	// lets every mesh be dequantized by the same transform.
+	void PreparePositionGrid(const ChunkIndex& Index)
+	{
+		std::array<float, 3> Min;
+		std::array<float, 3> Max;
+		Min.fill(std::numeric_limits<float>::max());
+		Max.fill(std::numeric_limits<float>::lowest());
 
-		// Add vertex data to gltf
-		std::int32_t VertexPositionAccessorIdx = -1;
-		std::int32_t VertexNormalAccessorIdx   = -1;
-		std::int32_t VertexTangentAccessorIdx  = -1;
-		std::int32_t VertexColorAccessorIdx    = -1;
-		std::int32_t VertexWeightsAccessorIdx  = -1;
-		std::int32_t VertexJointsAccessorIdx   = -1;
-		std::int32_t VertexTexCoordAccessorIdx = -1;
+		for( const ChunkIndex::Entry* CurEntry :
+			 Index.GetEntries(TagID::Geometry) )
 		{
-			tinygltf::Buffer VertexBuffer;
-			VertexBuffer.name
-				= VertexBuffer.name + Header.Name + ": VertexBuffer";
-			std::transform(
-					VertexData.begin(),
-					VertexData.end(),
-					std::back_inserter(VertexBuffer.data),
-					std::to_integer<unsigned char>
-				);
-			GLTFModel.buffers.push_back(VertexBuffer);
-
-			std::span<const float> FloatData(
-				(const float*)VertexData.data(),
-				VertexData.size() / sizeof(float)
-			);
+			std::span<const std::byte> Data = CurEntry->Data;
 
-			tinygltf::BufferView VertexBufferView;
-			VertexBufferView.name
-				= VertexBufferView.name + Header.Name + ": VertexBufferView";
-			VertexBufferView.buffer     = GLTFModel.buffers.size() - 1;
-			VertexBufferView.byteOffset = 0;
-			VertexBufferView.byteLength = VertexDataSize;
-			VertexBufferView.byteStride
-				= GetVertexBufferStride(Header.VertexAttributeMask);
-			VertexBufferView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
-			GLTFModel.bufferViews.push_back(VertexBufferView);
-
-			// Positions
-			if( const std::uint32_t AttribMask = 0b0000'0'0000'00'0001;
-				Header.VertexAttributeMask & AttribMask )
+			const auto          HeaderFields = Parse<"sfffflll">(Data);
+			const std::uint32_t VertexAttributeMask = std::get<6>(HeaderFields);
+			const std::uint32_t UnknownSkip         = std::get<7>(HeaderFields);
+			if( UnknownSkip != 0U || !(VertexAttributeMask & 1) )
 			{
-
-				tinygltf::Accessor PositionAccessor;
-				PositionAccessor.name
-					= PositionAccessor.name + Header.Name + ": Position";
-				PositionAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				PositionAccessor.byteOffset = GetVertexBufferStride(
-					(AttribMask - 1) & Header.VertexAttributeMask
-				);
-
-				PositionAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				PositionAccessor.count         = VertexCount;
-				PositionAccessor.type          = TINYGLTF_TYPE_VEC3;
-				AccessorMinMax<glm::vec3>(
-					VertexData, VertexBufferView, PositionAccessor
-				);
-
-				GLTFModel.accessors.push_back(PositionAccessor);
-				VertexPositionAccessorIdx = GLTFModel.accessors.size() - 1;
-
-				FloatData = FloatData.subspan(3);
+				continue;
 			}
 
-			// Normals
-			if( const std::uint32_t AttribMask = 0b0000'0'0000'00'0010;
-				Header.VertexAttributeMask & AttribMask )
+			const auto [VertexCount] = Parse<"l">(Data);
+			const std::size_t VertexStride
+				= GetVertexBufferStride(VertexAttributeMask);
+			if( VertexStride * VertexCount > Data.size() )
 			{
-				tinygltf::Accessor NormalAccessor;
-				NormalAccessor.name
-					= NormalAccessor.name + Header.Name + ": Normal";
-				NormalAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				NormalAccessor.byteOffset = GetVertexBufferStride(
-					(AttribMask - 1) & Header.VertexAttributeMask
-				);
-				NormalAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				NormalAccessor.count         = VertexCount;
-				NormalAccessor.type          = TINYGLTF_TYPE_VEC3;
-				AccessorMinMax<glm::vec3>(
-					VertexData, VertexBufferView, NormalAccessor
-				);
-
-				GLTFModel.accessors.push_back(NormalAccessor);
-				VertexNormalAccessorIdx = GLTFModel.accessors.size() - 1;
-
-				FloatData = FloatData.subspan(3);
+				throw std::out_of_range("Vertex data exceeds chunk size");
 			}
 
-			// Tangents
-			if( const std::uint32_t AttribMask = 0b0000'0'0000'00'0100;
-				Header.VertexAttributeMask & AttribMask )
+			// Positions are the first attribute of a vertex
+			for( std::size_t VertexIdx = 0; VertexIdx < VertexCount;
+				 ++VertexIdx )
 			{
-				tinygltf::Accessor TangentAccessor;
-				TangentAccessor.name
-					= TangentAccessor.name + Header.Name + ": Tangent";
-				TangentAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				TangentAccessor.byteOffset = GetVertexBufferStride(
-					(AttribMask - 1) & Header.VertexAttributeMask
-				);
-				TangentAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				TangentAccessor.count         = VertexCount;
-				TangentAccessor.type          = TINYGLTF_TYPE_VEC3;
-				AccessorMinMax<glm::vec3>(
-					VertexData, VertexBufferView, TangentAccessor
+				std::array<float, 3> Position;
+				std::memcpy(
+					Position.data(), Data.data() + VertexIdx * VertexStride,
+					sizeof(Position)
 				);
-
-				GLTFModel.accessors.push_back(TangentAccessor);
-				VertexTangentAccessorIdx = GLTFModel.accessors.size() - 1;
-				FloatData                = FloatData.subspan(3);
+				for( std::size_t i = 0; i < 3; ++i )
+				{
+					Min[i] = std::min(Min[i], Position[i]);
+					Max[i] = std::max(Max[i], Position[i]);
+				}
 			}
+		}
 
-			//  Vertex Color
-			if( const std::uint32_t AttribMask = 0b0000'0'0000'01'0000;
-				Header.VertexAttributeMask & AttribMask )
-			{
-				tinygltf::Accessor ColorAccessor;
-				ColorAccessor.name
-					= ColorAccessor.name + Header.Name + ": Color";
-				ColorAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				ColorAccessor.byteOffset = GetVertexBufferStride(
-					(AttribMask - 1) & Header.VertexAttributeMask
-				);
-				ColorAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				ColorAccessor.count         = VertexCount;
-				ColorAccessor.type          = TINYGLTF_TYPE_VEC4;
-				AccessorMinMax<glm::vec4>(
-					VertexData, VertexBufferView, ColorAccessor
-				);
+		// No positions at all
+		if( Min[0] > Max[0] )
+		{
+			return;
+		}
 
-				GLTFModel.accessors.push_back(ColorAccessor);
-				VertexColorAccessorIdx = GLTFModel.accessors.size() - 1;
+		// The scale is uniform so that the dequantization transform leaves
+		// the direction of normals alone
+		float Radius = 0.0f;
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			PositionGrid.Offset[i] = (Min[i] + Max[i]) * 0.5f;
+			Radius                 = std::max(Radius, (Max[i] - Min[i]) * 0.5f);
+		}
+		PositionGrid.Scale = Radius > 0.0f ? Radius / 32767.0f : 1.0f;
+	}
+
+	// Small textures are packed up-front, so that materials can refer to
+	// their atlas page as soon as they are visited
+	void PrepareAtlas(const ChunkIndex& Index)
+	{
+		// Largest page, and the gutter around each texture that keeps
+		// three mip levels from blending textures together
+		constexpr std::uint32_t AtlasPageSize = 2048;
+		constexpr std::uint32_t AtlasGutter   = 8;
+		constexpr std::uint16_t TexCoordMask  = 0b0001'0'0000'00'0000;
+
+		// Geometry with texture coordinates outside of [0, 1]
+		std::unordered_set<std::string_view> WrappingGeometry;
+		for( const ChunkIndex::Entry* CurEntry :
+			 Index.GetEntries(TagID::Geometry) )
+		{
+			std::span<const std::byte> Data = CurEntry->Data;
 
-				FloatData = FloatData.subspan(4);
+			const auto          HeaderFields = Parse<"sfffflll">(Data);
+			const std::uint32_t VertexAttributeMask = std::get<6>(HeaderFields);
+			const std::uint32_t UnknownSkip         = std::get<7>(HeaderFields);
+			if( UnknownSkip != 0U || !(VertexAttributeMask & TexCoordMask) )
+			{
+				continue;
 			}
 
-			//  Unknown
-			if( const std::uint32_t AttribMask = 0b0000'0'0000'10'0000;
-				Header.VertexAttributeMask & AttribMask )
+			const auto [VertexCount] = Parse<"l">(Data);
+			const std::size_t VertexStride
+				= GetVertexBufferStride(VertexAttributeMask);
+			const std::size_t TexCoordOffset = GetVertexBufferStride(
+				(TexCoordMask - 1) & VertexAttributeMask
+			);
+			if( VertexStride * VertexCount > Data.size() )
 			{
-				FloatData = FloatData.subspan(4);
+				throw std::out_of_range("Vertex data exceeds chunk size");
 			}
 
-			//  Weight {0,1,2,3}
-			if( const std::uint32_t AttribMask = 0b0000'0'1111'00'0000;
-				Header.VertexAttributeMask & AttribMask )
+			for( std::size_t VertexIdx = 0; VertexIdx < VertexCount;
+				 ++VertexIdx )
 			{
-				// Mask of all active weights
-				const std::uint32_t WeightMask
-					= Header.VertexAttributeMask & AttribMask;
-				const std::size_t WeightCount = std::popcount(WeightMask);
-				// Mask of the lowest active weight
-				const std::uint32_t WeightMaskLow = -WeightMask & WeightMask;
-				tinygltf::Accessor  WeightsAccessor;
-				WeightsAccessor.name
-					= WeightsAccessor.name + Header.Name + ": Weights";
-				WeightsAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				WeightsAccessor.byteOffset = GetVertexBufferStride(
-					(WeightMaskLow - 1) & Header.VertexAttributeMask
+				std::array<float, 2> TexCoord;
+				std::memcpy(
+					TexCoord.data(),
+					Data.data() + VertexIdx * VertexStride + TexCoordOffset,
+					sizeof(TexCoord)
 				);
-				WeightsAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				WeightsAccessor.count         = VertexCount;
-				WeightsAccessor.type          = TINYGLTF_TYPE_VEC4;
+				if( TexCoord[0] < 0.0f || TexCoord[0] > 1.0f
+					|| TexCoord[1] < 0.0f || TexCoord[1] > 1.0f )
+				{
+					WrappingGeometry.insert(std::get<0>(HeaderFields));
+					break;
+				}
+			}
+		}
 
-				AccessorMinMax<glm::vec4>(
-					VertexData, VertexBufferView, WeightsAccessor
-				);
+		std::unordered_map<std::string_view, std::string_view> MaterialTextures;
+		for( const ChunkIndex::Entry* CurEntry :
+			 Index.GetEntries(TagID::Material) )
+		{
+			std::span<const std::byte> Data = CurEntry->Data;
 
-				////
-				// The weights are stored as a variable amount of floats
-				// Use the first float to encode four normalized-bytes
-				WeightsAccessor.componentType
-					= TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
-				WeightsAccessor.normalized = true;
-				for( std::size_t VertexIdx = 0; VertexIdx < VertexCount;
-					 ++VertexIdx )
-				{
-					const std::span<std::uint8_t> CurWeightBytes
-						= std::span(VertexBuffer.data)
-							  .subspan(
-								  VertexIdx * VertexBufferView.byteStride
-								  + WeightsAccessor.byteOffset
-							  );
-
-					const std::span<const float> CurWeightData(
-						reinterpret_cast<const float*>(CurWeightBytes.data()),
-						WeightCount
-					);
+			const auto [MaterialName, MaterialType] = Parse<"sl">(Data);
+			const auto [TextureName]                = Parse<"s">(Data);
+			MaterialTextures.emplace(MaterialName, TextureName);
+		}
 
-					// Read float values into a vec4
-					glm::vec4 CurWeights = {};
-					std::copy(
-						CurWeightData.begin(),
-						CurWeightData.begin() + WeightCount,
-						glm::begin(CurWeights)
-					);
+		// Textures drawn onto wrapping geometry
+		std::unordered_set<std::string_view> WrappingTextures;
+		for( const ChunkIndex::Entry* CurEntry :
+			 Index.GetEntries(TagID::Mesh) )
+		{
+			std::span<const std::byte> Data = CurEntry->Data;
 
-					// Re-use the original float values to store four uint8s
-					std::span<std::uint8_t, 4> DestBytes
-						= CurWeightBytes.first<4>();
-					DestBytes[0] = static_cast<std::uint8_t>(
-						glm::round(CurWeights[0] * 0xff)
-					);
-					DestBytes[1] = static_cast<std::uint8_t>(
-						glm::round(CurWeights[1] * 0xff)
-					);
-					DestBytes[2] = static_cast<std::uint8_t>(
-						glm::round(CurWeights[2] * 0xff)
-					);
-					DestBytes[3] = static_cast<std::uint8_t>(
-						glm::round(CurWeights[3] * 0xff)
-					);
+			const auto [MeshName, SubmeshCount] = Parse<"sl">(Data);
+			for( std::uint32_t i = 0; i < SubmeshCount; ++i )
+			{
+				const auto [MaterialName, GeometryName] = Parse<"ss">(Data);
+				const auto FoundTexture = MaterialTextures.find(MaterialName);
+				if( FoundTexture != MaterialTextures.end()
+					&& WrappingGeometry.contains(GeometryName) )
+				{
+					WrappingTextures.insert(FoundTexture->second);
 				}
-				AccessorMinMax<glm::u8vec4>(
-					VertexData, VertexBufferView, WeightsAccessor
-				);
-				////
-
-				GLTFModel.accessors.push_back(WeightsAccessor);
-				VertexWeightsAccessorIdx = GLTFModel.accessors.size() - 1;
+			}
+		}
 
-				FloatData = FloatData.subspan(WeightCount);
+		// Textures with identical contents share their place in the atlas
+		std::vector<std::pair<std::string, std::size_t>> PackedTextures;
+		std::vector<Bitmap>                              Images;
+		std::vector<AlphaCoverage>                       Coverages;
+		std::unordered_map<const TextureCache::Image*, std::size_t>
+			ImageIndices;
+		for( const ChunkIndex::Entry* CurEntry :
+			 Index.GetEntries(TagID::Texture) )
+		{
+			std::span<const std::byte> Data = CurEntry->Data;
+			const auto [TextureName, TextureFileName] = Parse<"ss">(Data);
+			if( WrappingTextures.contains(TextureName) )
+			{
+				continue;
 			}
 
-			//  Joints
-			if( const std::uint32_t AttribMask = 0b0000'1'0000'00'0000;
-				Header.VertexAttributeMask & AttribMask )
+			// Textures that can not be decoded are left to be embedded as-is
+			try
 			{
-				tinygltf::Accessor JointsAccessor;
-				JointsAccessor.name
-					= JointsAccessor.name + Header.Name + ": Joints";
-				JointsAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				JointsAccessor.byteOffset = GetVertexBufferStride(
-					(AttribMask - 1) & Header.VertexAttributeMask
-				);
-				JointsAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				JointsAccessor.count         = VertexCount;
-				JointsAccessor.type          = TINYGLTF_TYPE_VEC4;
-				AccessorMinMax<glm::vec4>(
-					VertexData, VertexBufferView, JointsAccessor
-				);
+				const TextureCache::ImageData Source
+					= Textures->Load(GetTextureURI(TextureFileName));
 
-				////
-				// Joints seem to always be integer-valued floats
-				// Convert them to uint16
-				JointsAccessor.componentType
-					= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
-				for( std::size_t VertexIdx = 0; VertexIdx < VertexCount;
-					 ++VertexIdx )
+				const auto [Width, Height] = GetTGASize(Source->Data);
+				if( std::max(Width, Height) > Options.AtlasMaxSize
+					|| std::max(Width, Height) + 2 * AtlasGutter
+						   > AtlasPageSize )
 				{
-
-					const std::span CurJointBytes
-						= std::span(VertexBuffer.data)
-							  .subspan(
-								  VertexIdx * VertexBufferView.byteStride
-								  + JointsAccessor.byteOffset
-							  );
-					const std::span<const float> CurJointData(
-						reinterpret_cast<const float*>(CurJointBytes.data()), 4
-					);
-
-					// Read float values into a vec4
-					glm::vec4 CurJoints = {};
-					std::copy(
-						CurJointData.begin(), CurJointData.end(),
-						glm::begin(CurJoints)
-					);
-
-					// Re-use the original float values to store four uint16s
-					std::span<std::uint16_t, 4> DestJoints(
-						reinterpret_cast<std::uint16_t*>(CurJointBytes.data()),
-						4
-					);
-					DestJoints[0] = std::uint16_t(CurJoints[0]);
-					DestJoints[1] = std::uint16_t(CurJoints[1]);
-					DestJoints[2] = std::uint16_t(CurJoints[2]);
-					DestJoints[3] = std::uint16_t(CurJoints[3]);
+					continue;
 				}
-				AccessorMinMax<glm::u16vec4>(
-					VertexData, VertexBufferView, JointsAccessor
-				);
-				////
-
-				GLTFModel.accessors.push_back(JointsAccessor);
-				VertexJointsAccessorIdx = GLTFModel.accessors.size() - 1;
 
-				FloatData = FloatData.subspan(4);
+				const auto [FoundImage, NewImage]
+					= ImageIndices.try_emplace(Source.get(), Images.size());
+				if( NewImage )
+				{
+					Images.push_back(ToRGBA(DecodeTGA(Source->Data)));
+					Coverages.push_back(Textures->GetAlphaCoverage(Source));
+				}
+				PackedTextures.emplace_back(TextureName, FoundImage->second);
 			}
-
-			// TexCoord
-			if( const std::uint32_t AttribMask = 0b0001'0'0000'00'0000;
-				Header.VertexAttributeMask & AttribMask )
+			catch( const std::exception& Error )
 			{
-				tinygltf::Accessor TexCoordAccessor;
-				TexCoordAccessor.name = TexCoordAccessor.name + Header.Name
-									  + ": TextureCoordinates";
-				TexCoordAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-				TexCoordAccessor.byteOffset = GetVertexBufferStride(
-					(AttribMask - 1) & Header.VertexAttributeMask
+				TSUHAN_TRACE(
+					Info, "\t%.*s: %s, not packed\n",
+					(std::uint32_t)TextureFileName.size(),
+					TextureFileName.data(), Error.what()
 				);
-				TexCoordAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-				TexCoordAccessor.count         = VertexCount;
-				TexCoordAccessor.type          = TINYGLTF_TYPE_VEC2;
-				AccessorMinMax<glm::vec2>(
-					VertexData, VertexBufferView, TexCoordAccessor
-				);
-
-				GLTFModel.accessors.push_back(TexCoordAccessor);
-				VertexTexCoordAccessorIdx = GLTFModel.accessors.size() - 1;
-				FloatData                 = FloatData.subspan(2);
 			}
 		}
 
-		Data = Data.subspan(VertexDataSize);
-
-		std::uint32_t IndexStreamCount;
-		PrintFormattedBytes(Data, "l");
-		Data = ReadFormattedBytes(Data, "l", &IndexStreamCount);
+		// A single image gains nothing from an atlas
+		if( Images.size() < 2 )
+		{
+			return;
+		}
+
+		std::vector<const Bitmap*> ImagePointers;
+		for( const Bitmap& CurImage : Images )
+		{
+			ImagePointers.push_back(&CurImage);
+		}
+		Atlas PackedAtlas
+			= PackAtlas(ImagePointers, AtlasPageSize, AtlasGutter);
+
+		for( const auto& [TextureName, ImageIdx] : PackedTextures )
+		{
+			const Bitmap&         CurImage = Images[ImageIdx];
+			const AtlasPlacement& CurPlacement
+				= PackedAtlas.Placements[ImageIdx];
+			const Bitmap& CurPage = PackedAtlas.Pages[CurPlacement.Page];
+			AtlasLUT.emplace(
+				TextureName,
+				AtlasRegion{
+					CurPlacement.Page,
+					{float(CurPlacement.X) / CurPage.Width,
+					 float(CurPlacement.Y) / CurPage.Height},
+					{float(CurImage.Width) / CurPage.Width,
+					 float(CurImage.Height) / CurPage.Height},
+					Coverages[ImageIdx],
+				}
+			);
+		}
+
+		TSUHAN_TRACE(
+			Info, "%zu textures packed into %zu atlas pages\n",
+			PackedTextures.size(), PackedAtlas.Pages.size()
+		);
+
+		AtlasPages = std::move(PackedAtlas.Pages);
+		AtlasPageTextures.assign(AtlasPages.size(), -1);
+
+		// Only models with packed textures draw through a texture transform
+		if( !AtlasLUT.empty() )
+		{
+			GLTFModel.extensionsUsed.push_back("KHR_texture_transform");
+			GLTFModel.extensionsRequired.push_back("KHR_texture_transform");
+		}
+	}
+
+	// Texture of an atlas page, which is added on first use
+	std::int32_t GetAtlasPageTexture(std::uint32_t Page)
+	{
+		if( AtlasPageTextures[Page] >= 0 )
+		{
+			return AtlasPageTextures[Page];
+		}
+
+		const std::string PageName = "Atlas" + std::to_string(Page);
+
+		const std::int32_t ImageBufferViewIdx
+			= AddBufferView(PageName + ": BufferView");
+		WriteBufferView(ImageBufferViewIdx, EncodePNG(AtlasPages[Page]));
+
+		tinygltf::Image NewImage;
+		NewImage.name       = PageName;
+		NewImage.bufferView = ImageBufferViewIdx;
+		NewImage.mimeType   = "image/png";
+		GLTFModel.images.push_back(NewImage);
+
+		tinygltf::Texture NewTexture;
+		NewTexture.name   = PageName;
+		NewTexture.source = GLTFModel.images.size() - 1;
+		GLTFModel.textures.push_back(NewTexture);
+
+		AtlasPageTextures[Page] = GLTFModel.textures.size() - 1;
+		return AtlasPageTextures[Page];
+	}
+
+	// Geometry chunks only depend on their own data, so they are converted
+	// up-front on the thread pool and added to the model once visited. The
+	// geometry is ready once `Group` has been waited on.
+	void PrepareGeometry(
+		const ChunkIndex& Index, ThreadPool& Pool, ThreadPool::TaskGroup& Group
+	)
+	{
+		const auto GeometryEntries = Index.GetEntries(TagID::Geometry);
+		if( GeometryEntries.size() < 2 )
+		{
+			return;
+		}
+
+		// Create all the slots first, the tasks only write to their own
+		for( const ChunkIndex::Entry* CurEntry : GeometryEntries )
+		{
+			PreparedGeometry.try_emplace(CurEntry->Data.data());
+		}
+
+		for( const ChunkIndex::Entry* CurEntry : GeometryEntries )
+		{
+			auto& Result = PreparedGeometry.at(CurEntry->Data.data());
+			Pool.Submit(Group, [this, CurEntry, &Result]() {
+				Result = ConvertGeometry(CurEntry->Data);
+			});
+		}
+	}
+
+	// Textures are transcoded up-front on the thread pool into the texture
+	// cache, from which they are added to the model once visited. Textures
+	// that fail are traced, and left for the visit to fall back on.
+	void PrepareTextures(
+		const ChunkIndex& Index, ThreadPool& Pool, ThreadPool::TaskGroup& Group
+	)
+	{
+		for( const ChunkIndex::Entry* CurEntry :
+			 Index.GetEntries(TagID::Texture) )
+		{
+			std::span<const std::byte> Data = CurEntry->Data;
+			const auto [TextureName, TextureFileName] = Parse<"ss">(Data);
+			if( AtlasLUT.contains(std::string(TextureName)) )
+			{
+				continue;
+			}
+
+			Pool.Submit(
+				Group,
+				[this, TextureURI = GetTextureURI(TextureFileName)]() {
+					try
+					{
+						const TextureCache::ImageData Source
+							= Textures->Load(TextureURI);
+						if( Options.BakeTextures )
+						{
+							Textures->GetKTX2(
+								Source, GetKTX2Path(TextureURI),
+								Options.KaiserMips, Options.Pool
+							);
+						}
+						Textures->GetPNG(Source);
+						Textures->GetAlphaCoverage(Source);
+					}
+					catch( const std::exception& Error )
+					{
+						TSUHAN_TRACE(
+							Info, "\t%s: %s, not prepared\n",
+							TextureURI.filename().string().c_str(),
+							Error.what()
+						);
+					}
+				}
+			);
+		}
+	}
+
+	void VisitGeometry(std::span<const std::byte> Data) override
+	{
+		// Committed in file order, so the output does not depend on the
+		// order in which geometry was converted
+		std::optional<ConvertedGeometry> Geometry;
+		if( const auto Found = PreparedGeometry.find(Data.data());
+			Found != PreparedGeometry.end() )
+		{
+			Geometry = std::move(Found->second);
+			PreparedGeometry.erase(Found);
+		}
+		else
+		{
+			Geometry = ConvertGeometry(Data);
+		}
+
+		if( Options.Batch && Geometry )
+		{
+			std::string GeometryName = Geometry->Name;
+			PendingGeometry.insert_or_assign(
+				std::move(GeometryName), std::move(*Geometry)
+			);
+		}
+		else
+		{
+			CommitGeometry(std::move(Geometry));
+		}
+	}
+
+	// Adds a converted geometry's buffer views and accessors to the model
+	void CommitGeometry(std::optional<ConvertedGeometry>&& Geometry)
+	{
+		if( !Geometry )
+		{
+			return;
+		}
+
+		const std::int32_t BaseBufferViewIdx = GLTFModel.bufferViews.size();
+		const std::int32_t BaseAccessorIdx   = GLTFModel.accessors.size();
+
+		for( PendingBufferView& CurBufferView : Geometry->BufferViews )
+		{
+			GLTFModel.bufferViews.emplace_back(
+				std::move(CurBufferView.BufferView)
+			);
+			WriteBufferView(
+				GLTFModel.bufferViews.size() - 1, CurBufferView.Data
+			);
+		}
+
+		for( tinygltf::Accessor& CurAccessor : Geometry->Accessors )
+		{
+			CurAccessor.bufferView += BaseBufferViewIdx;
+			GLTFModel.accessors.push_back(std::move(CurAccessor));
+		}
+
+		for( std::int32_t& CurAccessorIdx : Geometry->AccessorIndices )
+		{
+			if( CurAccessorIdx >= 0 )
+			{
+				CurAccessorIdx += BaseAccessorIdx;
+			}
+		}
+
+		for( GeometryPartition& CurPartition : Geometry->Partitions )
+		{
+			CurPartition.IndexAccessorIdx += BaseAccessorIdx;
+		}
+
+		PartitionLUT.insert_or_assign(
+			Geometry->Name, std::move(Geometry->Partitions)
+		);
+		GeometryLUT.insert_or_assign(
+			std::move(Geometry->Name), Geometry->AccessorIndices
+		);
+	}
+
+	// Converts a geometry chunk without touching the model. Empty if the
+	// chunk has no geometry data.
+	std::optional<ConvertedGeometry>
+		ConvertGeometry(std::span<const std::byte> Data) const
+	{
+		// sfffflll
+		struct GeometryHeader
+		{
+			std::string_view Name;
+			float            UnknownA;
+			float            UnknownB;
+			float            UnknownC;
+			float            UnknownD;
+			std::uint32_t    UnknownE; // UnknownFlag
+			std::uint32_t    VertexAttributeMask;
+
+			// Not sure what this indicates but when non-zero then it skips
+			// loading all geometry data from the file.
+			std::uint32_t UnknownSkip;
+		};
+		const auto HeaderFields = Parse<"sfffflll">(Data);
+		TraceFields(HeaderFields);
+		const auto Header = std::make_from_tuple<GeometryHeader>(HeaderFields);
+
+		if( Header.UnknownSkip != 0U )
+		{
+			return std::nullopt;
+		}
+
+		ConvertedGeometry Result;
+		Result.Name = Header.Name;
+
+		// Vertex and index data
+		Result.BufferViews.reserve(2);
+
+		const auto VertexCountField = Parse<"l">(Data);
+		TraceFields(VertexCountField);
+		std::uint32_t     VertexCount = std::get<0>(VertexCountField);
+		const std::size_t VertexDataSize
+			= GetVertexBufferStride(Header.VertexAttributeMask) * VertexCount;
+		if( VertexDataSize > Data.size() )
+		{
+			throw std::out_of_range("Vertex data exceeds chunk size");
+		}
+
+		// Vertex data
+		std::span<const std::byte> VertexData = Data.first(VertexDataSize);
+		Data                                  = Data.subspan(VertexDataSize);
+
+		const auto IndexStreamCountField = Parse<"l">(Data);
+		TraceFields(IndexStreamCountField);
+		const auto [IndexStreamCount] = IndexStreamCountField;
 
 		// This is technically iterated, but there has yet to be a single
 		// mesh that uses anything other than 1
@@ -623,280 +1010,1643 @@ public:
 
 		// for( std::size_t i = 0; i < IndexStreamCount; ++i )
 		//{
-		std::uint32_t UnknownOne; // Index format?
-		std::uint32_t CurIndexCount;
-		PrintFormattedBytes(Data, "ll");
-		Data = ReadFormattedBytes(Data, "ll", &UnknownOne, &CurIndexCount);
+		// UnknownOne: Index format?
+		const auto IndexStreamFields = Parse<"ll">(Data);
+		TraceFields(IndexStreamFields);
+		const auto [UnknownOne, CurIndexCount] = IndexStreamFields;
 
 		const std::size_t IndexDataSize = CurIndexCount * sizeof(std::uint16_t);
+		if( IndexDataSize > Data.size() )
+		{
+			throw std::out_of_range("Index data exceeds chunk size");
+		}
 
 		const std::span<const std::uint16_t> IndexData{
 			reinterpret_cast<const std::uint16_t*>(Data.data()), CurIndexCount
 		};
 
-		// Add vertex data to gltf
-		std::int32_t IndexAccessorIdx = -1;
+		Data = Data.subspan(IndexDataSize);
+		//}
+
+		////
+		// The indices are rewritten before the vertices are converted, as
+		// welding changes which vertices there are. Vertices are welded
+		// before the strip is unrolled, so that the triangles that welding
+		// collapses are dropped along with the strip's own degenerates.
+		std::vector<std::uint16_t>     NewIndices;
+		std::span<const std::uint16_t> Indices          = IndexData;
+		bool                           IndicesRewritten = false;
+
+		// Vertices that remain after welding
+		std::vector<std::byte> WeldedVertexData;
+
+		const std::vector<std::uint32_t> WeldKeys
+			= Options.Weld ? GetWeldKeys(
+								 VertexData, VertexCount,
+								 Header.VertexAttributeMask, Options.WeldEpsilon
+							 )
+						   : std::vector<std::uint32_t>();
+		if( !WeldKeys.empty() )
 		{
-			tinygltf::Buffer IndexBuffer;
-			IndexBuffer.name = IndexBuffer.name + Header.Name + ": IndexBuffer";
-			std::transform(
-					std::as_bytes(IndexData).begin(),
-					std::as_bytes(IndexData).end(),
-					std::back_inserter(IndexBuffer.data),
-					std::to_integer<unsigned char>
+			NewIndices.assign(IndexData.begin(), IndexData.end());
+
+			if( !NewIndices.empty()
+				&& std::ranges::max(NewIndices) >= VertexCount )
+			{
+				throw std::out_of_range("Index exceeds vertex count");
+			}
+
+			const std::vector<std::uint32_t> WeldedVertices = WeldVertices(
+				NewIndices, WeldKeys, WeldKeys.size() / VertexCount
+			);
+			TSUHAN_TRACE(
+				Info, "\t%.*s: %u vertices, welded to %zu\n",
+				(std::uint32_t)Header.Name.size(), Header.Name.data(),
+				VertexCount, WeldedVertices.size()
+			);
+
+			// Gather the remaining vertices in their new order
+			const std::size_t VertexStride
+				= GetVertexBufferStride(Header.VertexAttributeMask);
+			WeldedVertexData.resize(WeldedVertices.size() * VertexStride);
+			for( std::size_t i = 0; i < WeldedVertices.size(); ++i )
+			{
+				std::memcpy(
+					WeldedVertexData.data() + i * VertexStride,
+					VertexData.data() + WeldedVertices[i] * VertexStride,
+					VertexStride
 				);
-			GLTFModel.buffers.push_back(IndexBuffer);
+			}
 
-			tinygltf::BufferView IndexBufferView;
-			IndexBufferView.buffer     = GLTFModel.buffers.size() - 1;
-			IndexBufferView.byteOffset = 0;
-			IndexBufferView.byteLength = IndexDataSize;
-			IndexBufferView.target     = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
-			GLTFModel.bufferViews.push_back(IndexBufferView);
+			VertexData       = WeldedVertexData;
+			VertexCount      = WeldedVertices.size();
+			Indices          = NewIndices;
+			IndicesRewritten = true;
+		}
 
-			tinygltf::Accessor VertexAccessor;
-			VertexAccessor.bufferView = GLTFModel.bufferViews.size() - 1;
-			VertexAccessor.byteOffset = 0;
-			VertexAccessor.maxValues.push_back(
-				*std::max_element(IndexData.begin(), IndexData.end())
+		if( Options.TriangleList )
+		{
+			// Cache size of the simulated GPU, when reporting the ACMR
+			constexpr std::size_t ACMRCacheSize = 16;
+
+			NewIndices = UnrollTriangleStrip(Indices);
+
+			const float ACMRBefore = ComputeACMR(NewIndices, ACMRCacheSize);
+			OptimizeVertexCache(NewIndices);
+			TSUHAN_TRACE(
+				Info, "\t%.*s: %zu triangles, ACMR %.3f -> %.3f\n",
+				(std::uint32_t)Header.Name.size(), Header.Name.data(),
+				NewIndices.size() / 3, ACMRBefore,
+				ComputeACMR(NewIndices, ACMRCacheSize)
 			);
-			VertexAccessor.minValues.push_back(
-				*std::min_element(IndexData.begin(), IndexData.end())
+
+			Indices          = NewIndices;
+			IndicesRewritten = true;
+		}
+
+		// Vertices of each skin partition. Vertices that partitions share
+		// are duplicated, as their joints are renumbered for each partition.
+		std::vector<std::byte> PartitionedVertexData;
+
+		// First index and index count of each partition
+		std::vector<std::pair<std::size_t, std::size_t>> PartitionRanges;
+
+		const std::vector<std::int32_t> VertexJoints
+			= Options.MaxSkinJoints ? GetVertexJoints(
+										  VertexData, VertexCount,
+										  Header.VertexAttributeMask
+									  )
+									: std::vector<std::int32_t>();
+		std::vector<std::int32_t> UsedJoints(VertexJoints);
+		std::ranges::sort(UsedJoints);
+		UsedJoints.erase(
+			std::unique(UsedJoints.begin(), UsedJoints.end()), UsedJoints.end()
+		);
+		std::erase(UsedJoints, -1);
+
+		if( UsedJoints.size() > Options.MaxSkinJoints )
+		{
+			// Partitions are made of whole triangles
+			assert(IndicesRewritten);
+
+			if( !NewIndices.empty()
+				&& std::ranges::max(NewIndices) >= VertexCount )
+			{
+				throw std::out_of_range("Index exceeds vertex count");
+			}
+
+			const std::vector<SkinPartition> Partitions
+				= PartitionSkin(
+					NewIndices, VertexJoints, Options.MaxSkinJoints
+				);
+
+			std::size_t PartitionedVertexCount = 0;
+			for( const SkinPartition& CurPartition : Partitions )
+			{
+				PartitionedVertexCount += CurPartition.Vertices.size();
+			}
+
+			TSUHAN_TRACE(
+				Info, "\t%.*s: %zu joints, split into %zu partitions of %zu "
+					  "vertices\n",
+				(std::uint32_t)Header.Name.size(), Header.Name.data(),
+				UsedJoints.size(), Partitions.size(), PartitionedVertexCount
 			);
-			VertexAccessor.componentType
-				= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
-			VertexAccessor.count = CurIndexCount;
-			VertexAccessor.type  = TINYGLTF_TYPE_SCALAR;
 
-			GLTFModel.accessors.push_back(VertexAccessor);
-			IndexAccessorIdx = GLTFModel.accessors.size() - 1;
+			// The duplicated vertices must still be reachable by 16-bit
+			// indices, otherwise the geometry is left whole
+			if( PartitionedVertexCount <= 0x10000 )
+			{
+				const std::size_t VertexStride
+					= GetVertexBufferStride(Header.VertexAttributeMask);
+				const std::size_t JointOffset = GetVertexBufferStride(
+					(0b0000'1'0000'00'0000 - 1) & Header.VertexAttributeMask
+				);
+
+				PartitionedVertexData.resize(
+					PartitionedVertexCount * VertexStride
+				);
+				NewIndices.clear();
+
+				std::byte* CurVertex = PartitionedVertexData.data();
+				for( const SkinPartition& CurPartition : Partitions )
+				{
+					const std::size_t BaseVertex
+						= (CurVertex - PartitionedVertexData.data())
+						/ VertexStride;
+
+					for( const std::uint32_t SourceVertex :
+						 CurPartition.Vertices )
+					{
+						std::memcpy(
+							CurVertex,
+							VertexData.data() + SourceVertex * VertexStride,
+							VertexStride
+						);
+
+						// Unused joints have no weight and become the first
+						// joint of the palette
+						std::array<float, 4> Joints = {};
+						for( std::size_t i = 0; i < 4; ++i )
+						{
+							const std::int32_t CurJoint
+								= VertexJoints[SourceVertex * 4 + i];
+							if( CurJoint >= 0 )
+							{
+								Joints[i] = static_cast<float>(
+									std::ranges::find(
+										CurPartition.Joints, CurJoint
+									)
+									- CurPartition.Joints.begin()
+								);
+							}
+						}
+						std::memcpy(
+							CurVertex + JointOffset, Joints.data(),
+							sizeof(Joints)
+						);
+
+						CurVertex += VertexStride;
+					}
+
+					PartitionRanges.emplace_back(
+						NewIndices.size(), CurPartition.Indices.size()
+					);
+					for( const std::uint16_t CurIndex : CurPartition.Indices )
+					{
+						NewIndices.push_back(BaseVertex + CurIndex);
+					}
+
+					Result.Partitions.push_back({-1, CurPartition.Joints});
+				}
+
+				VertexData  = PartitionedVertexData;
+				VertexCount = PartitionedVertexCount;
+				Indices     = NewIndices;
+			}
+		}
+		////
+
+		// Add vertex data to gltf
+		std::int32_t VertexPositionAccessorIdx = -1;
+		std::int32_t VertexNormalAccessorIdx   = -1;
+		std::int32_t VertexTangentAccessorIdx  = -1;
+		std::int32_t VertexColorAccessorIdx    = -1;
+		std::int32_t VertexWeightsAccessorIdx  = -1;
+		std::int32_t VertexJointsAccessorIdx   = -1;
+		std::int32_t VertexTexCoordAccessorIdx = -1;
+		{
+			PendingBufferView& VertexView = Result.BufferViews.emplace_back();
+			const std::int32_t VertexBufferViewIdx
+				= Result.BufferViews.size() - 1;
+
+			const std::size_t VertexStride
+				= GetVertexBufferStride(Header.VertexAttributeMask);
+
+			// Byte-offset of an attribute within a source vertex
+			const auto AttributeOffset = [&](std::uint32_t AttribMask) {
+				return GetVertexBufferStride(
+					(AttribMask - 1) & Header.VertexAttributeMask
+				);
+			};
+
+			const std::uint32_t PositionMask
+				= Header.VertexAttributeMask & 0b0000'0'0000'00'0001;
+			const std::uint32_t NormalMask
+				= Header.VertexAttributeMask & 0b0000'0'0000'00'0010;
+			const std::uint32_t TangentMask
+				= Header.VertexAttributeMask & 0b0000'0'0000'00'0100;
+			const std::uint32_t ColorMask
+				= Header.VertexAttributeMask & 0b0000'0'0000'01'0000;
+			const std::uint32_t TexCoordMask
+				= Header.VertexAttributeMask & 0b0001'0'0000'00'0000;
+
+			// Mask of all active weights
+			const std::uint32_t WeightMask
+				= Header.VertexAttributeMask & 0b0000'0'1111'00'0000;
+			const std::size_t WeightCount = std::popcount(WeightMask);
+			// Mask of the lowest active weight
+			const std::uint32_t WeightMaskLow = -WeightMask & WeightMask;
+
+			const std::uint32_t JointMask
+				= Header.VertexAttributeMask & 0b0000'1'0000'00'0000;
+
+			////
+			// Bounds of every float of a vertex up to the last exported float
+			// attribute, found in a single pass over the vertices. Only the
+			// lanes of exported attributes are read from the result.
+			constexpr std::size_t MaxVertexFloats = 144 / sizeof(float);
+			std::array<float, MaxVertexFloats> FloatMin{};
+			std::array<float, MaxVertexFloats> FloatMax{};
+
+			std::size_t BoundedFloatCount = 0;
+			for( const std::uint32_t CurMask :
+				 {PositionMask, NormalMask, TangentMask, ColorMask,
+				  TexCoordMask} )
+			{
+				if( CurMask )
+				{
+					const std::size_t AttributeEnd
+						= AttributeOffset(CurMask)
+						+ GetVertexBufferStride(CurMask);
+					BoundedFloatCount = std::max(
+						BoundedFloatCount, AttributeEnd / sizeof(float)
+					);
+				}
+			}
+
+			FloatBounds(
+				VertexData, VertexStride, VertexCount,
+				std::span(FloatMin).first(BoundedFloatCount),
+				std::span(FloatMax).first(BoundedFloatCount)
+			);
+
+			// Assigns the bounds of a float attribute to its accessor
+			const auto FloatMinMax = [&](tinygltf::Accessor& Accessor,
+										 std::uint32_t       AttribMask,
+										 std::size_t         ComponentCount) {
+				if( VertexCount == 0 )
+				{
+					return;
+				}
+
+				const std::size_t FirstFloat
+					= AttributeOffset(AttribMask) / sizeof(float);
+				Accessor.minValues.assign(
+					FloatMin.begin() + FirstFloat,
+					FloatMin.begin() + FirstFloat + ComponentCount
+				);
+				Accessor.maxValues.assign(
+					FloatMax.begin() + FirstFloat,
+					FloatMax.begin() + FirstFloat + ComponentCount
+				);
+			};
+
+			// Assigns the bounds of a re-encoded attribute to its accessor
+			const auto AssignMinMax = [&](tinygltf::Accessor& Accessor,
+										  const auto& Min, const auto& Max) {
+				if( VertexCount == 0 )
+				{
+					return;
+				}
+
+				Accessor.minValues.assign(Min.begin(), Min.end());
+				Accessor.maxValues.assign(Max.begin(), Max.end());
+			};
+			////
+
+			////
+			// Layout of the written vertices. Only the attributes that are
+			// exposed as accessors are written, packed tightly in the order
+			// of the source. Every attribute stays at a multiple of four
+			// bytes, as KHR_mesh_quantization requires.
+			const bool Quantize = Options.Quantize;
+
+			// Texture coordinates can only be unorm16s if they do not wrap
+			bool QuantizeTexCoord = Quantize && TexCoordMask;
+			if( QuantizeTexCoord && VertexCount != 0 )
+			{
+				const std::size_t FirstFloat
+					= AttributeOffset(TexCoordMask) / sizeof(float);
+				for( std::size_t i = FirstFloat; i < FirstFloat + 2; ++i )
+				{
+					QuantizeTexCoord &= FloatMin[i] >= 0.0f;
+					QuantizeTexCoord &= FloatMax[i] <= 1.0f;
+				}
+			}
+
+			std::size_t DestStride = 0;
+
+			// Byte-offset of an attribute within a written vertex
+			const auto DestOffset = [&](std::uint32_t AttribMask,
+										std::size_t   DestSize) {
+				if( !AttribMask )
+				{
+					return std::size_t(0);
+				}
+
+				const std::size_t Offset = DestStride;
+				DestStride += DestSize;
+				return Offset;
+			};
+
+			// int16x3, padded or floatx3
+			const std::size_t PositionDestOffset
+				= DestOffset(PositionMask, Quantize ? 8 : 12);
+			// snorm8x3, padded or floatx3
+			const std::size_t NormalDestOffset
+				= DestOffset(NormalMask, Quantize ? 4 : 12);
+			// snorm8x4 or floatx3
+			const std::size_t TangentDestOffset
+				= DestOffset(TangentMask, Quantize ? 4 : 12);
+			// unorm8x4 or floatx4
+			const std::size_t ColorDestOffset
+				= DestOffset(ColorMask, Quantize ? 4 : 16);
+			// unorm8x4
+			const std::size_t WeightDestOffset = DestOffset(WeightMaskLow, 4);
+			// uint16x4
+			const std::size_t JointDestOffset = DestOffset(JointMask, 8);
+			// unorm16x2 or floatx2
+			const std::size_t TexCoordDestOffset
+				= DestOffset(TexCoordMask, QuantizeTexCoord ? 4 : 8);
+			////
+
+			tinygltf::BufferView& VertexBufferView = VertexView.BufferView;
+			VertexBufferView.name
+				= std::string(Header.Name) + ": VertexBufferView";
+			VertexBufferView.buffer     = 0;
+			VertexBufferView.byteStride = DestStride;
+			VertexBufferView.target     = TINYGLTF_TARGET_ARRAY_BUFFER;
+
+			// The vertex data is repacked so it needs its own copy
+			std::vector<std::byte>& VertexBuffer = VertexView.Storage;
+			VertexBuffer.assign(VertexCount * DestStride, std::byte{0});
+
+			// Source and destination of an attribute's first vertex
+			const auto AttributeSource = [&](std::uint32_t AttribMask) {
+				return VertexData.subspan(AttributeOffset(AttribMask));
+			};
+			const auto AttributeDest = [&](std::size_t Offset) {
+				return std::span(VertexBuffer).subspan(Offset);
+			};
+
+			// Copies a float attribute that is not re-encoded
+			const auto CopyAttribute = [&](std::uint32_t AttribMask,
+										   std::size_t   Offset,
+										   std::size_t   ComponentCount) {
+				if( !AttribMask || VertexCount == 0 )
+				{
+					return;
+				}
+
+				CopyVertices(
+					AttributeSource(AttribMask), AttributeDest(Offset),
+					VertexStride, DestStride, VertexCount,
+					ComponentCount * sizeof(float)
+				);
+			};
+
+			std::array<std::int16_t, 3>  PositionMin = {};
+			std::array<std::int16_t, 3>  PositionMax = {};
+			std::array<std::int8_t, 3>   NormalMin   = {};
+			std::array<std::int8_t, 3>   NormalMax   = {};
+			std::array<std::int8_t, 4>   TangentMin  = {};
+			std::array<std::int8_t, 4>   TangentMax  = {};
+			std::array<std::uint8_t, 4>  ColorMin    = {};
+			std::array<std::uint8_t, 4>  ColorMax    = {};
+			std::array<std::uint16_t, 2> TexCoordMin = {};
+			std::array<std::uint16_t, 2> TexCoordMax = {};
+			if( Quantize && VertexCount != 0 )
+			{
+				if( PositionMask )
+				{
+					QuantizePositions(
+						AttributeSource(PositionMask),
+						AttributeDest(PositionDestOffset), VertexStride,
+						DestStride, VertexCount, PositionGrid.Offset,
+						PositionGrid.Scale, PositionMin, PositionMax
+					);
+				}
+				if( NormalMask )
+				{
+					QuantizeNormals(
+						AttributeSource(NormalMask),
+						AttributeDest(NormalDestOffset), VertexStride,
+						DestStride, VertexCount, NormalMin, NormalMax
+					);
+				}
+				if( TangentMask )
+				{
+					QuantizeTangents(
+						AttributeSource(TangentMask),
+						AttributeDest(TangentDestOffset), VertexStride,
+						DestStride, VertexCount, TangentMin, TangentMax
+					);
+				}
+				if( ColorMask )
+				{
+					QuantizeColors(
+						AttributeSource(ColorMask),
+						AttributeDest(ColorDestOffset), VertexStride,
+						DestStride, VertexCount, ColorMin, ColorMax
+					);
+				}
+			}
+			else
+			{
+				CopyAttribute(PositionMask, PositionDestOffset, 3);
+				CopyAttribute(NormalMask, NormalDestOffset, 3);
+				CopyAttribute(TangentMask, TangentDestOffset, 3);
+				CopyAttribute(ColorMask, ColorDestOffset, 4);
+			}
+
+			if( QuantizeTexCoord && VertexCount != 0 )
+			{
+				QuantizeTexCoords(
+					AttributeSource(TexCoordMask),
+					AttributeDest(TexCoordDestOffset), VertexStride,
+					DestStride, VertexCount, TexCoordMin, TexCoordMax
+				);
+			}
+			else
+			{
+				CopyAttribute(TexCoordMask, TexCoordDestOffset, 2);
+			}
+
+			// The weights are stored as a variable amount of floats
+			// Encode them as four normalized-bytes
+			std::array<std::uint8_t, 4> WeightMin = {};
+			std::array<std::uint8_t, 4> WeightMax = {};
+			if( WeightMask && VertexCount != 0 )
+			{
+				QuantizeWeights(
+					AttributeSource(WeightMaskLow),
+					AttributeDest(WeightDestOffset), VertexStride, DestStride,
+					VertexCount, WeightCount, WeightMin, WeightMax
+				);
+			}
+
+			// Joints seem to always be integer-valued floats
+			// Encode them as four uint16s
+			std::array<std::uint16_t, 4> JointMin = {};
+			std::array<std::uint16_t, 4> JointMax = {};
+			if( JointMask && VertexCount != 0 )
+			{
+				QuantizeJoints(
+					AttributeSource(JointMask), AttributeDest(JointDestOffset),
+					VertexStride, DestStride, VertexCount, JointMin, JointMax
+				);
+			}
+
+			// Positions
+			if( PositionMask )
+			{
+				tinygltf::Accessor PositionAccessor;
+				PositionAccessor.name
+					= std::string(Header.Name) + ": Position";
+				PositionAccessor.bufferView = VertexBufferViewIdx;
+				PositionAccessor.byteOffset = PositionDestOffset;
+				PositionAccessor.count      = VertexCount;
+				PositionAccessor.type       = TINYGLTF_TYPE_VEC3;
+				if( Quantize )
+				{
+					PositionAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_SHORT;
+					AssignMinMax(PositionAccessor, PositionMin, PositionMax);
+				}
+				else
+				{
+					PositionAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_FLOAT;
+					FloatMinMax(PositionAccessor, PositionMask, 3);
+				}
+
+				Result.Accessors.push_back(PositionAccessor);
+				VertexPositionAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			// Normals
+			if( NormalMask )
+			{
+				tinygltf::Accessor NormalAccessor;
+				NormalAccessor.name
+					= std::string(Header.Name) + ": Normal";
+				NormalAccessor.bufferView = VertexBufferViewIdx;
+				NormalAccessor.byteOffset = NormalDestOffset;
+				NormalAccessor.count      = VertexCount;
+				NormalAccessor.type       = TINYGLTF_TYPE_VEC3;
+				if( Quantize )
+				{
+					NormalAccessor.componentType = TINYGLTF_COMPONENT_TYPE_BYTE;
+					NormalAccessor.normalized    = true;
+					AssignMinMax(NormalAccessor, NormalMin, NormalMax);
+				}
+				else
+				{
+					NormalAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_FLOAT;
+					FloatMinMax(NormalAccessor, NormalMask, 3);
+				}
+
+				Result.Accessors.push_back(NormalAccessor);
+				VertexNormalAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			// Tangents
+			if( TangentMask )
+			{
+				tinygltf::Accessor TangentAccessor;
+				TangentAccessor.name
+					= std::string(Header.Name) + ": Tangent";
+				TangentAccessor.bufferView = VertexBufferViewIdx;
+				TangentAccessor.byteOffset = TangentDestOffset;
+				TangentAccessor.count      = VertexCount;
+				if( Quantize )
+				{
+					TangentAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_BYTE;
+					TangentAccessor.normalized    = true;
+					TangentAccessor.type          = TINYGLTF_TYPE_VEC4;
+					AssignMinMax(TangentAccessor, TangentMin, TangentMax);
+				}
+				else
+				{
+					TangentAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_FLOAT;
+					TangentAccessor.type = TINYGLTF_TYPE_VEC3;
+					FloatMinMax(TangentAccessor, TangentMask, 3);
+				}
+
+				Result.Accessors.push_back(TangentAccessor);
+				VertexTangentAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			//  Vertex Color
+			if( ColorMask )
+			{
+				tinygltf::Accessor ColorAccessor;
+				ColorAccessor.name
+					= std::string(Header.Name) + ": Color";
+				ColorAccessor.bufferView = VertexBufferViewIdx;
+				ColorAccessor.byteOffset = ColorDestOffset;
+				ColorAccessor.count      = VertexCount;
+				ColorAccessor.type       = TINYGLTF_TYPE_VEC4;
+				if( Quantize )
+				{
+					ColorAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+					ColorAccessor.normalized = true;
+					AssignMinMax(ColorAccessor, ColorMin, ColorMax);
+				}
+				else
+				{
+					ColorAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+					FloatMinMax(ColorAccessor, ColorMask, 4);
+				}
+
+				Result.Accessors.push_back(ColorAccessor);
+				VertexColorAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			//  Weight {0,1,2,3}
+			if( WeightMask )
+			{
+				tinygltf::Accessor WeightsAccessor;
+				WeightsAccessor.name
+					= std::string(Header.Name) + ": Weights";
+				WeightsAccessor.bufferView = VertexBufferViewIdx;
+				WeightsAccessor.byteOffset = WeightDestOffset;
+				WeightsAccessor.componentType
+					= TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+				WeightsAccessor.normalized = true;
+				WeightsAccessor.count      = VertexCount;
+				WeightsAccessor.type       = TINYGLTF_TYPE_VEC4;
+				AssignMinMax(WeightsAccessor, WeightMin, WeightMax);
+
+				Result.Accessors.push_back(WeightsAccessor);
+				VertexWeightsAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			//  Joints
+			if( JointMask )
+			{
+				tinygltf::Accessor JointsAccessor;
+				JointsAccessor.name
+					= std::string(Header.Name) + ": Joints";
+				JointsAccessor.bufferView = VertexBufferViewIdx;
+				JointsAccessor.byteOffset = JointDestOffset;
+				JointsAccessor.componentType
+					= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+				JointsAccessor.count = VertexCount;
+				JointsAccessor.type  = TINYGLTF_TYPE_VEC4;
+				AssignMinMax(JointsAccessor, JointMin, JointMax);
+
+				Result.Accessors.push_back(JointsAccessor);
+				VertexJointsAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			// TexCoord
+			if( TexCoordMask )
+			{
+				tinygltf::Accessor TexCoordAccessor;
+				TexCoordAccessor.name
+					= std::string(Header.Name) + ": TextureCoordinates";
+				TexCoordAccessor.bufferView = VertexBufferViewIdx;
+				TexCoordAccessor.byteOffset = TexCoordDestOffset;
+				TexCoordAccessor.count      = VertexCount;
+				TexCoordAccessor.type       = TINYGLTF_TYPE_VEC2;
+				if( QuantizeTexCoord )
+				{
+					TexCoordAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+					TexCoordAccessor.normalized = true;
+					AssignMinMax(TexCoordAccessor, TexCoordMin, TexCoordMax);
+				}
+				else
+				{
+					TexCoordAccessor.componentType
+						= TINYGLTF_COMPONENT_TYPE_FLOAT;
+					FloatMinMax(TexCoordAccessor, TexCoordMask, 2);
+				}
+
+				Result.Accessors.push_back(TexCoordAccessor);
+				VertexTexCoordAccessorIdx = Result.Accessors.size() - 1;
+			}
+
+			VertexView.Data = VertexBuffer;
+		}
+
+		// Add vertex data to gltf
+		std::int32_t IndexAccessorIdx = -1;
+		{
+			PendingBufferView& IndexView = Result.BufferViews.emplace_back();
+			const std::int32_t IndexBufferViewIdx
+				= Result.BufferViews.size() - 1;
+
+			IndexView.BufferView.name
+				= std::string(Header.Name) + ": IndexBufferView";
+			IndexView.BufferView.buffer = 0;
+			IndexView.BufferView.target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
+
+			if( IndicesRewritten )
+			{
+				IndexView.Storage.resize(
+					Indices.size() * sizeof(std::uint16_t)
+				);
+				std::memcpy(
+					IndexView.Storage.data(), Indices.data(),
+					IndexView.Storage.size()
+				);
+				IndexView.Data = IndexView.Storage;
+			}
+			else
+			{
+				// Written straight from the chunk
+				IndexView.Data = std::as_bytes(IndexData);
+			}
+
+			tinygltf::Accessor VertexAccessor;
+			VertexAccessor.bufferView = IndexBufferViewIdx;
+			VertexAccessor.byteOffset = 0;
+			if( !Indices.empty() )
+			{
+				const auto [IndexMin, IndexMax]
+					= std::minmax_element(Indices.begin(), Indices.end());
+				VertexAccessor.maxValues.push_back(*IndexMax);
+				VertexAccessor.minValues.push_back(*IndexMin);
+			}
+			VertexAccessor.componentType
+				= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+			VertexAccessor.count = Indices.size();
+			VertexAccessor.type  = TINYGLTF_TYPE_SCALAR;
+
+			Result.Accessors.push_back(VertexAccessor);
+			IndexAccessorIdx = Result.Accessors.size() - 1;
+
+			// Each partition's range of the index buffer view
+			for( std::size_t i = 0; i < Result.Partitions.size(); ++i )
+			{
+				const auto [FirstIndex, IndexCount] = PartitionRanges[i];
+				const std::span<const std::uint16_t> PartitionIndices
+					= Indices.subspan(FirstIndex, IndexCount);
+
+				tinygltf::Accessor PartitionAccessor;
+				PartitionAccessor.bufferView = IndexBufferViewIdx;
+				PartitionAccessor.byteOffset
+					= FirstIndex * sizeof(std::uint16_t);
+				if( !PartitionIndices.empty() )
+				{
+					const auto [IndexMin, IndexMax]
+						= std::ranges::minmax_element(PartitionIndices);
+					PartitionAccessor.maxValues.push_back(*IndexMax);
+					PartitionAccessor.minValues.push_back(*IndexMin);
+				}
+				PartitionAccessor.componentType
+					= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+				PartitionAccessor.count = IndexCount;
+				PartitionAccessor.type  = TINYGLTF_TYPE_SCALAR;
+
+				Result.Accessors.push_back(PartitionAccessor);
+				Result.Partitions[i].IndexAccessorIdx
+					= Result.Accessors.size() - 1;
+			}
+		}
+
+		Result.AccessorIndices = {
+			IndexAccessorIdx,
+			VertexPositionAccessorIdx,
+			VertexNormalAccessorIdx,
+			VertexTangentAccessorIdx,
+			VertexColorAccessorIdx,
+			VertexWeightsAccessorIdx,
+			VertexJointsAccessorIdx,
+			VertexTexCoordAccessorIdx,
+		};
+
+		return Result;
+	}
+
+	void VisitMaterial(std::span<const std::byte> Data) override
+	{
+		// sl
+		const auto MaterialFields = Parse<"sl">(Data);
+		TraceFields(MaterialFields);
+		const std::string MaterialName(std::get<0>(MaterialFields));
+		const auto        MaterialType = std::get<1>(MaterialFields);
+
+		tinygltf::Material NewMaterial;
+		NewMaterial.name        = MaterialName;
+		NewMaterial.doubleSided = true;
+
+		NewMaterial.pbrMetallicRoughness.metallicFactor = 0.0;
+		NewMaterial.pbrMetallicRoughness.baseColorFactor
+			= {1.0f, 1.0f, 1.0f, 1.0f};
+		NewMaterial.extensions["KHR_materials_unlit"] = {};
+
+		const auto TextureField = Parse<"s">(Data);
+		TraceFields(TextureField);
+		const std::string TextureName(std::get<0>(TextureField));
+
+		// BaseColor
+		const auto BaseColorFields = Parse<"ffff">(Data);
+		TraceFields(BaseColorFields);
+		const auto [BaseColorR, BaseColorG, BaseColorB, BaseColorA]
+			= BaseColorFields;
+		NewMaterial.pbrMetallicRoughness.baseColorFactor = {
+			BaseColorR,
+			BaseColorG,
+			BaseColorB,
+			BaseColorA,
+		};
+
+		if( MaterialType > 0 )
+		{
+			// Texture offset/scale?
+			TraceFields(Parse<"ffff">(Data));
+		}
+
+		switch( MaterialType )
+		{
+		case 2:
+		case 3:
+		case 4:
+		case 6:
+		case 7:
+		{
+			// List of bones used for skinning
+			const auto BoneCountField = Parse<"l">(Data);
+			TraceFields(BoneCountField);
+			const auto [BoneCount] = BoneCountField;
+
+			if( BoneCount != 0u )
+			{
+				tinygltf::Skin NewSkin;
+				NewSkin.name = MaterialName;
+
+				for( std::size_t i = 0; i < BoneCount; ++i )
+				{
+					const auto BoneField = Parse<"s">(Data);
+					TraceFields(BoneField);
+					const std::string BoneName(std::get<0>(BoneField));
+
+					// The names of these bones might not actually exist in the
+					// HGM yet, and might be referring to another skeleton in
+					// another file in the case of cosmetics. Need a way to do
+					// references across files
+					if( TransformLUT.contains(BoneName) )
+					{
+						NewSkin.joints.push_back(TransformLUT.at(BoneName));
+					}
+				}
+
+				GLTFModel.skins.push_back(NewSkin);
+				SkinLUT.emplace(MaterialName, GLTFModel.skins.size() - 1);
+			}
+			break;
+		}
+		default:
+		{
+			break;
+		}
+		}
+
+		// Materials visited before their texture are updated once it is
+		AlphaCoverage Coverage = AlphaCoverage::Opaque;
+		if( const auto FoundRegion = AtlasLUT.find(TextureName);
+			FoundRegion != AtlasLUT.end() )
+		{
+			const AtlasRegion& Region = FoundRegion->second;
+
+			tinygltf::TextureInfo& BaseColorTexture
+				= NewMaterial.pbrMetallicRoughness.baseColorTexture;
+			BaseColorTexture.texCoord = 0;
+			BaseColorTexture.index    = GetAtlasPageTexture(Region.Page);
+			BaseColorTexture.extensions["KHR_texture_transform"]
+				= tinygltf::Value(tinygltf::Value::Object{
+					{"offset", tinygltf::Value(tinygltf::Value::Array{
+								   tinygltf::Value(Region.Offset[0]),
+								   tinygltf::Value(Region.Offset[1]),
+							   })},
+					{"scale", tinygltf::Value(tinygltf::Value::Array{
+								  tinygltf::Value(Region.Scale[0]),
+								  tinygltf::Value(Region.Scale[1]),
+							  })},
+				});
+			Coverage = Region.Coverage;
+		}
+		else if( TextureName != "__NOTEX__" )
+		{
+			if( !TextureLUT.contains(TextureName) )
+			{
+				// Texture might not exist yet, put a place-holder
+				// for now
+				GLTFModel.textures.push_back({});
+				TextureLUT.emplace(TextureName, GLTFModel.textures.size() - 1);
+			}
+			NewMaterial.pbrMetallicRoughness.baseColorTexture.texCoord = 0;
+			NewMaterial.pbrMetallicRoughness.baseColorTexture.index
+				= TextureLUT.at(TextureName);
+
+			if( const auto Found
+				= TextureCoverageLUT.find(TextureLUT.at(TextureName));
+				Found != TextureCoverageLUT.end() )
+			{
+				Coverage = Found->second;
+			}
+		}
+		SetAlphaMode(NewMaterial, Coverage);
+		GLTFModel.materials.push_back(NewMaterial);
+		MaterialLUT.emplace(MaterialName, GLTFModel.materials.size() - 1);
+	}
+	// Blends materials with translucent textures or base colors, and masks
+	// those with cut-out textures
+	static void
+		SetAlphaMode(tinygltf::Material& Material, AlphaCoverage Coverage)
+	{
+		if( Coverage == AlphaCoverage::Translucent
+			|| Material.pbrMetallicRoughness.baseColorFactor[3] < 1.0 )
+		{
+			Material.alphaMode = "BLEND";
+		}
+		else if( Coverage == AlphaCoverage::Cutout )
+		{
+			Material.alphaMode   = "MASK";
+			Material.alphaCutoff = 0.5;
+		}
+		else
+		{
+			Material.alphaMode = "OPAQUE";
+		}
+	}
+
+	void VisitMesh(std::span<const std::byte> Data) override
+	{
+		// sl
+		const auto [MeshName, SubmeshCount] = Parse<"sl">(Data);
+
+		PendingMesh NewMesh;
+		NewMesh.Name = MeshName;
+
+		for( std::uint32_t i = 0; i < SubmeshCount; ++i )
+		{
+			const auto [MaterialName, GeometryName] = Parse<"ss">(Data);
+			TSUHAN_TRACE(
+				Verbose, "\t%u : (Material: %.*s, Geometry: %.*s)\n", i,
+				(std::uint32_t)MaterialName.size(), MaterialName.data(),
+				(std::uint32_t)GeometryName.size(), GeometryName.data()
+			);
+
+			NewMesh.Submeshes.push_back(
+				{std::string(MaterialName), std::string(GeometryName)}
+			);
+		}
+
+		if( Options.Batch )
+		{
+			PendingMeshes.push_back(std::move(NewMesh));
+			MeshLUT.emplace(MeshName, PendingMeshes.size() - 1);
+		}
+		else
+		{
+			AddMesh(NewMesh);
+			MeshLUT.emplace(MeshName, GLTFModel.meshes.size() - 1);
+		}
+	}
+	// Adds a mesh with a primitive for each of its submeshes
+	void AddMesh(const PendingMesh& Mesh)
+	{
+		tinygltf::Mesh NewMesh;
+		NewMesh.name = Mesh.Name;
+
+		for( const Submesh& CurSubmesh : Mesh.Submeshes )
+		{
+			// Geometry held back for batching is only added once it is used
+			if( const auto Found
+				= PendingGeometry.find(CurSubmesh.GeometryName);
+				Found != PendingGeometry.end() )
+			{
+				CommitGeometry(std::move(Found->second));
+				PendingGeometry.erase(Found);
+			}
+
+			const auto& Geo = GeometryLUT.at(CurSubmesh.GeometryName);
+			tinygltf::Primitive NewPrimitive;
+
+			if( Geo[0] >= 0 )
+			{
+				NewPrimitive.indices = Geo[0];
+			}
+
+			for( std::size_t AttributeIndex = 0;
+				 AttributeIndex < VertexAttributeNames.size();
+				 ++AttributeIndex )
+			{
+				if( Geo[AttributeIndex + 1] >= 0 )
+				{
+					NewPrimitive
+						.attributes[VertexAttributeNames[AttributeIndex]]
+						= Geo[AttributeIndex + 1];
+				}
+			}
+			NewPrimitive.material = MaterialLUT.at(CurSubmesh.MaterialName);
+			NewPrimitive.mode     = Options.TriangleList
+									  ? TINYGLTF_MODE_TRIANGLES
+									  : TINYGLTF_MODE_TRIANGLE_STRIP;
+
+			const auto& Partitions = PartitionLUT.at(CurSubmesh.GeometryName);
+			if( Partitions.empty() )
+			{
+				NewMesh.primitives.push_back(NewPrimitive);
+				continue;
+			}
+
+			// A primitive for each skin partition
+			const std::vector<std::int32_t>& PartitionSkins
+				= GetPartitionSkins(CurSubmesh);
+			for( std::size_t i = 0; i < Partitions.size(); ++i )
+			{
+				tinygltf::Value::Array JointPalette;
+				for( const std::uint16_t CurJoint : Partitions[i].Joints )
+				{
+					JointPalette.emplace_back(static_cast<int>(CurJoint));
+				}
+
+				tinygltf::Value::Object Extras;
+				Extras["jointPalette"] = tinygltf::Value(JointPalette);
+				if( PartitionSkins[i] >= 0 )
+				{
+					Extras["skin"] = tinygltf::Value(PartitionSkins[i]);
+				}
+
+				tinygltf::Primitive PartitionPrimitive = NewPrimitive;
+				PartitionPrimitive.indices = Partitions[i].IndexAccessorIdx;
+				PartitionPrimitive.extras  = tinygltf::Value(Extras);
+				NewMesh.primitives.push_back(PartitionPrimitive);
+			}
+		}
+
+		GLTFModel.meshes.push_back(NewMesh);
+	}
+	// Skin of each partition of a submesh's geometry, made of the joints of
+	// its material's skin that are in the partition's palette. -1 for each
+	// partition if the material has no skin.
+	const std::vector<std::int32_t>&
+		GetPartitionSkins(const Submesh& CurSubmesh)
+	{
+		const auto Key
+			= std::make_pair(CurSubmesh.MaterialName, CurSubmesh.GeometryName);
+		if( const auto Found = PartitionSkinLUT.find(Key);
+			Found != PartitionSkinLUT.end() )
+		{
+			return Found->second;
+		}
+
+		const auto& Partitions = PartitionLUT.at(CurSubmesh.GeometryName);
+		std::vector<std::int32_t> Result(Partitions.size(), -1);
+
+		if( const auto FoundSkin = SkinLUT.find(CurSubmesh.MaterialName);
+			FoundSkin != SkinLUT.end() )
+		{
+			for( std::size_t i = 0; i < Partitions.size(); ++i )
+			{
+				const tinygltf::Skin& MaterialSkin
+					= GLTFModel.skins[FoundSkin->second];
+
+				tinygltf::Skin NewSkin;
+				NewSkin.name = MaterialSkin.name + ": "
+							 + CurSubmesh.GeometryName + ": Partition "
+							 + std::to_string(i);
+				for( const std::uint16_t CurJoint : Partitions[i].Joints )
+				{
+					if( CurJoint < MaterialSkin.joints.size() )
+					{
+						NewSkin.joints.push_back(MaterialSkin.joints[CurJoint]);
+					}
+				}
+
+				GLTFModel.skins.push_back(std::move(NewSkin));
+				Result[i] = GLTFModel.skins.size() - 1;
+			}
+		}
+
+		return PartitionSkinLUT.emplace(Key, std::move(Result)).first->second;
+	}
+	// World matrix of every node, from the hierarchy of the scene
+	std::vector<glm::mat4> GetWorldMatrices() const
+	{
+		std::vector<glm::mat4> Result(GLTFModel.nodes.size(), glm::mat4(1.0f));
+
+		const auto LocalMatrix = [](const tinygltf::Node& Node) {
+			glm::mat4 Local(1.0f);
+			if( Node.translation.size() == 3 )
+			{
+				Local = glm::translate(
+					Local, glm::vec3(
+							   Node.translation[0], Node.translation[1],
+							   Node.translation[2]
+						   )
+				);
+			}
+			if( Node.rotation.size() == 4 )
+			{
+				// glTF rotations are stored as XYZW
+				Local *= glm::mat4_cast(glm::quat(
+					Node.rotation[3], Node.rotation[0], Node.rotation[1],
+					Node.rotation[2]
+				));
+			}
+			if( Node.scale.size() == 3 )
+			{
+				Local = glm::scale(
+					Local,
+					glm::vec3(Node.scale[0], Node.scale[1], Node.scale[2])
+				);
+			}
+			return Local;
+		};
+
+		const auto VisitNode = [&](std::size_t NodeIdx, const glm::mat4& Parent,
+								   auto& Self) -> void {
+			Result[NodeIdx] = Parent * LocalMatrix(GLTFModel.nodes[NodeIdx]);
+			for( const int CurChild : GLTFModel.nodes[NodeIdx].children )
+			{
+				Self(CurChild, Result[NodeIdx], Self);
+			}
+		};
+
+		// Nodes that are not the child of any other node are roots
+		std::vector<bool> IsChild(GLTFModel.nodes.size(), false);
+		for( const tinygltf::Node& CurNode : GLTFModel.nodes )
+		{
+			for( const int CurChild : CurNode.children )
+			{
+				IsChild[CurChild] = true;
+			}
+		}
+		for( std::size_t i = 0; i < GLTFModel.nodes.size(); ++i )
+		{
+			if( !IsChild[i] )
+			{
+				VisitNode(i, glm::mat4(1.0f), VisitNode);
+			}
+		}
+
+		return Result;
+	}
+	// Merges the unskinned submeshes of all meshes placed in the scene into
+	// a primitive per material, pre-transformed by the world matrix of their
+	// node. Everything else is added as usual.
+	void BuildBatches()
+	{
+		// Vertices of a primitive are addressed by 16-bit indices
+		constexpr std::size_t MaxBatchVertices = 0x10000;
+
+		const std::vector<glm::mat4> WorldMatrices = GetWorldMatrices();
+
+		// Batches of each material and set of vertex attributes
+		std::map<std::pair<std::int32_t, std::uint32_t>, std::vector<Batch>>
+					Batches;
+		std::size_t BatchedCount = 0;
+
+		for( PendingMesh& CurMesh : PendingMeshes )
+		{
+			// Not placed in the scene
+			if( CurMesh.Nodes.empty() )
+			{
+				continue;
+			}
+
+			std::vector<Submesh> Remaining;
+			for( Submesh& CurSubmesh : CurMesh.Submeshes )
+			{
+				const auto Found
+					= PendingGeometry.find(CurSubmesh.GeometryName);
+				if( Found == PendingGeometry.end() )
+				{
+					Remaining.push_back(std::move(CurSubmesh));
+					continue;
+				}
+				const ConvertedGeometry& Geometry = Found->second;
+				const auto& AccessorIndices       = Geometry.AccessorIndices;
+
+				// Skinned geometry has to stay with its skeleton
+				const bool IsStatic
+					= !SkinLUT.contains(CurSubmesh.MaterialName)
+				   && AccessorIndices[0] >= 0 && AccessorIndices[1] >= 0
+				   && AccessorIndices[5] < 0 && AccessorIndices[6] < 0
+				   && Geometry.Accessors[AccessorIndices[1]].count
+						  <= MaxBatchVertices;
+				if( !IsStatic )
+				{
+					Remaining.push_back(std::move(CurSubmesh));
+					continue;
+				}
+
+				const tinygltf::Accessor& PositionAccessor
+					= Geometry.Accessors[AccessorIndices[1]];
+				const PendingBufferView& VertexView
+					= Geometry.BufferViews[PositionAccessor.bufferView];
+				const std::size_t VertexCount = PositionAccessor.count;
+				const std::size_t Stride = VertexView.BufferView.byteStride;
+
+				const PendingBufferView& IndexView = Geometry.BufferViews
+					[Geometry.Accessors[AccessorIndices[0]].bufferView];
+				std::span<const std::uint16_t> Indices(
+					reinterpret_cast<const std::uint16_t*>(
+						IndexView.Data.data()
+					),
+					IndexView.Data.size() / sizeof(std::uint16_t)
+				);
+
+				// Batches are always triangle lists
+				std::vector<std::uint16_t> TriangleList;
+				if( !Options.TriangleList )
+				{
+					TriangleList = UnrollTriangleStrip(Indices);
+					Indices      = TriangleList;
+				}
+
+				std::uint32_t AttributeMask = 0;
+				for( std::size_t i = 0; i < VertexAttributeNames.size(); ++i )
+				{
+					AttributeMask |= (AccessorIndices[i + 1] >= 0) << i;
+				}
+
+				std::vector<Batch>& MaterialBatches = Batches[{
+					MaterialLUT.at(CurSubmesh.MaterialName), AttributeMask
+				}];
+				for( const std::uint32_t CurNode : CurMesh.Nodes )
+				{
+					if( MaterialBatches.empty()
+						|| MaterialBatches.back().Vertices.size() / Stride
+								   + VertexCount
+							   > MaxBatchVertices )
+					{
+						Batch& NewBatch = MaterialBatches.emplace_back();
+						NewBatch.Stride = Stride;
+						for( std::size_t i = 0; i < VertexAttributeNames.size();
+							 ++i )
+						{
+							if( AccessorIndices[i + 1] >= 0 )
+							{
+								NewBatch.Attributes[i] = Geometry.Accessors
+									[AccessorIndices[i + 1]];
+							}
+						}
+					}
+
+					tinygltf::Value::Object Range;
+					Range["node"]
+						= tinygltf::Value(GLTFModel.nodes[CurNode].name);
+					Range["mesh"] = tinygltf::Value(CurMesh.Name);
+					AppendToBatch(
+						MaterialBatches.back(),
+						VertexView.Data.first(VertexCount * Stride), Indices,
+						WorldMatrices[CurNode], std::move(Range)
+					);
+				}
+				++BatchedCount;
+			}
+			CurMesh.Submeshes = std::move(Remaining);
+		}
+
+		// Everything that was not batched
+		for( const PendingMesh& CurMesh : PendingMeshes )
+		{
+			if( CurMesh.Submeshes.empty() )
+			{
+				continue;
+			}
+
+			AddMesh(CurMesh);
+			for( const std::uint32_t CurNode : CurMesh.Nodes )
+			{
+				GLTFModel.nodes.at(CurNode).mesh = GLTFModel.meshes.size() - 1;
+			}
+		}
+
+		std::size_t PrimitiveCount = 0;
+		for( const auto& [Key, MaterialBatches] : Batches )
+		{
+			AddBatchMesh(Key.first, MaterialBatches);
+			PrimitiveCount += MaterialBatches.size();
 		}
 
-		Data = Data.subspan(IndexDataSize);
-		//}
-
-		GeometryLUT.insert_or_assign(
-			Header.Name,
-			std::array<std::int32_t, 16>{
-				IndexAccessorIdx,
-				VertexPositionAccessorIdx,
-				VertexNormalAccessorIdx,
-				VertexTangentAccessorIdx,
-				VertexColorAccessorIdx,
-				VertexWeightsAccessorIdx,
-				VertexJointsAccessorIdx,
-				VertexTexCoordAccessorIdx,
-			}
+		TSUHAN_TRACE(
+			Info, "\t%zu submeshes batched into %zu primitives\n",
+			BatchedCount, PrimitiveCount
 		);
 	}
-
-	void VisitMaterial(std::span<const std::byte> Data) override
+	// Appends the triangle list of a submesh to a batch, transformed by
+	// `World`
+	static void AppendToBatch(
+		Batch& CurBatch, std::span<const std::byte> Vertices,
+		std::span<const std::uint16_t> Indices, const glm::mat4& World,
+		tinygltf::Value::Object&& Range
+	)
 	{
-		// sl
-		char          MaterialName[256];
-		std::uint32_t MaterialType;
-		PrintFormattedBytes(Data, "sl");
-		Data = ReadFormattedBytes(Data, "sl", MaterialName, &MaterialType);
+		const std::size_t BaseVertex
+			= CurBatch.Vertices.size() / CurBatch.Stride;
+		const std::size_t FirstIndex  = CurBatch.Indices.size();
+		const std::size_t VertexCount = Vertices.size() / CurBatch.Stride;
 
-		tinygltf::Material NewMaterial;
-		NewMaterial.name        = MaterialName;
-		NewMaterial.doubleSided = true;
+		CurBatch.Vertices.insert(
+			CurBatch.Vertices.end(), Vertices.begin(), Vertices.end()
+		);
 
-		NewMaterial.pbrMetallicRoughness.metallicFactor = 0.0;
-		NewMaterial.pbrMetallicRoughness.baseColorFactor
-			= {1.0f, 1.0f, 1.0f, 1.0f};
-		NewMaterial.extensions["KHR_materials_unlit"] = {};
+		// Transforms a three-float attribute of each of the new vertices
+		const auto TransformAttribute
+			= [&](const std::optional<tinygltf::Accessor>& Attribute,
+				  const auto&                              Transform) {
+				  if( !Attribute )
+				  {
+					  return;
+				  }
+
+				  for( std::size_t VertexIdx = BaseVertex;
+					   VertexIdx < BaseVertex + VertexCount; ++VertexIdx )
+				  {
+					  std::byte* CurValue = CurBatch.Vertices.data()
+										  + VertexIdx * CurBatch.Stride
+										  + Attribute->byteOffset;
+					  glm::vec3 Value;
+					  std::memcpy(&Value, CurValue, sizeof(Value));
+					  Value = Transform(Value);
+					  std::memcpy(CurValue, &Value, sizeof(Value));
+				  }
+			  };
+
+		const auto Normalize = [](const glm::vec3& Vector) {
+			const float Length = glm::length(Vector);
+			return Length > 0.0f ? Vector / Length : Vector;
+		};
 
-		PrintFormattedBytes(Data, "s");
-		char TextureName[256];
-		Data = ReadFormattedBytes(Data, "s", TextureName, &MaterialType);
+		const glm::mat3 TangentMatrix(World);
+		const glm::mat3 NormalMatrix
+			= glm::transpose(glm::inverse(TangentMatrix));
 
-		// BaseColor
-		glm::vec4 BaseColor;
-		PrintFormattedBytes(Data, "ffff");
-		Data = ReadFormattedBytes(
-			Data, "ffff", &BaseColor[0], &BaseColor[1], &BaseColor[2],
-			&BaseColor[3]
+		TransformAttribute(
+			CurBatch.Attributes[0],
+			[&](const glm::vec3& Position) {
+				return glm::vec3(World * glm::vec4(Position, 1.0f));
+			}
+		);
+		TransformAttribute(
+			CurBatch.Attributes[1],
+			[&](const glm::vec3& Normal) {
+				return Normalize(NormalMatrix * Normal);
+			}
+		);
+		TransformAttribute(
+			CurBatch.Attributes[2],
+			[&](const glm::vec3& Tangent) {
+				return Normalize(TangentMatrix * Tangent);
+			}
 		);
-		NewMaterial.pbrMetallicRoughness.baseColorFactor = {
-			BaseColor.r,
-			BaseColor.g,
-			BaseColor.b,
-			BaseColor.a,
-		};
 
-		if( MaterialType > 0 )
+		// Mirroring transforms flip the winding of the triangles
+		const bool Mirrored = glm::determinant(TangentMatrix) < 0.0f;
+		for( std::size_t i = 0; i + 2 < Indices.size(); i += 3 )
 		{
-			// Texture offset/scale?
-			Data = PrintFormattedBytes(Data, "ffff");
+			CurBatch.Indices.insert(
+				CurBatch.Indices.end(),
+				{
+					static_cast<std::uint16_t>(BaseVertex + Indices[i + 0]),
+					static_cast<std::uint16_t>(
+						BaseVertex + Indices[i + (Mirrored ? 2 : 1)]
+					),
+					static_cast<std::uint16_t>(
+						BaseVertex + Indices[i + (Mirrored ? 1 : 2)]
+					),
+				}
+			);
 		}
 
-		switch( MaterialType )
-		{
-		case 2:
-		case 3:
-		case 4:
-		case 6:
-		case 7:
+		Range["firstIndex"] = tinygltf::Value(static_cast<int>(FirstIndex));
+		Range["indexCount"] = tinygltf::Value(
+			static_cast<int>(CurBatch.Indices.size() - FirstIndex)
+		);
+		Range["firstVertex"] = tinygltf::Value(static_cast<int>(BaseVertex));
+		Range["vertexCount"] = tinygltf::Value(static_cast<int>(VertexCount));
+		CurBatch.Ranges.emplace_back(std::move(Range));
+	}
+	// Adds a mesh with a primitive for each batch of a material, placed at
+	// the root of the scene
+	void AddBatchMesh(
+		std::int32_t MaterialIdx, const std::vector<Batch>& Batches
+	)
+	{
+		tinygltf::Mesh NewMesh;
+		NewMesh.name = "Batch: " + GLTFModel.materials.at(MaterialIdx).name;
+
+		for( const Batch& CurBatch : Batches )
 		{
-			// List of bones used for skinning
-			std::uint32_t BoneCount;
-			PrintFormattedBytes(Data, "l");
-			Data = ReadFormattedBytes(Data, "l", &BoneCount);
+			const std::size_t VertexCount
+				= CurBatch.Vertices.size() / CurBatch.Stride;
 
-			if( BoneCount != 0u )
-			{
-				tinygltf::Skin NewSkin;
-				NewSkin.name = MaterialName;
+			tinygltf::Primitive NewPrimitive;
 
-				char BoneName[256];
-				for( std::size_t i = 0; i < BoneCount; ++i )
+			const std::int32_t VertexBufferViewIdx = AddBufferView(
+				NewMesh.name + ": VertexBufferView", CurBatch.Stride,
+				TINYGLTF_TARGET_ARRAY_BUFFER
+			);
+			WriteBufferView(VertexBufferViewIdx, CurBatch.Vertices);
+
+			for( std::size_t i = 0; i < VertexAttributeNames.size(); ++i )
+			{
+				if( !CurBatch.Attributes[i] )
 				{
-					PrintFormattedBytes(Data, "s");
-					Data = ReadFormattedBytes(Data, "s", BoneName);
+					continue;
+				}
 
-					// The names of these bones might not actually exist in the
-					// HGM yet, and might be referring to another skeleton in
-					// another file in the case of cosmetics. Need a way to do
-					// references across files
-					if( TransformLUT.contains(BoneName) )
+				tinygltf::Accessor NewAccessor = *CurBatch.Attributes[i];
+				NewAccessor.name
+					= NewMesh.name + ": " + VertexAttributeNames[i];
+				NewAccessor.bufferView = VertexBufferViewIdx;
+				NewAccessor.count      = VertexCount;
+				NewAccessor.minValues.clear();
+				NewAccessor.maxValues.clear();
+
+				// Positions are the only attribute that requires bounds
+				if( i == 0 && VertexCount != 0 )
+				{
+					std::array<float, 3> Min;
+					std::array<float, 3> Max;
+					Min.fill(std::numeric_limits<float>::max());
+					Max.fill(std::numeric_limits<float>::lowest());
+					for( std::size_t VertexIdx = 0; VertexIdx < VertexCount;
+						 ++VertexIdx )
 					{
-						NewSkin.joints.push_back(TransformLUT.at(BoneName));
+						std::array<float, 3> Position;
+						std::memcpy(
+							Position.data(),
+							CurBatch.Vertices.data()
+								+ VertexIdx * CurBatch.Stride
+								+ NewAccessor.byteOffset,
+							sizeof(Position)
+						);
+						for( std::size_t j = 0; j < 3; ++j )
+						{
+							Min[j] = std::min(Min[j], Position[j]);
+							Max[j] = std::max(Max[j], Position[j]);
+						}
 					}
+					NewAccessor.minValues.assign(Min.begin(), Min.end());
+					NewAccessor.maxValues.assign(Max.begin(), Max.end());
 				}
 
-				GLTFModel.skins.push_back(NewSkin);
-				SkinLUT.emplace(MaterialName, GLTFModel.skins.size() - 1);
+				GLTFModel.accessors.push_back(NewAccessor);
+				NewPrimitive.attributes[VertexAttributeNames[i]]
+					= GLTFModel.accessors.size() - 1;
 			}
-			break;
-		}
-		default:
-		{
-			break;
-		}
-		}
 
-		if( std::string_view(TextureName) != "__NOTEX__" )
-		{
-			if( !TextureLUT.contains(TextureName) )
+			const std::int32_t IndexBufferViewIdx = AddBufferView(
+				NewMesh.name + ": IndexBufferView", 0,
+				TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER
+			);
+			WriteBufferView(
+				IndexBufferViewIdx, std::as_bytes(std::span(CurBatch.Indices))
+			);
+
+			tinygltf::Accessor IndexAccessor;
+			IndexAccessor.bufferView = IndexBufferViewIdx;
+			IndexAccessor.byteOffset = 0;
+			if( !CurBatch.Indices.empty() )
 			{
-				// Texture might not exist yet, put a place-holder
-				// for now
-				GLTFModel.textures.push_back({});
-				TextureLUT.emplace(TextureName, GLTFModel.textures.size() - 1);
+				const auto [IndexMin, IndexMax] = std::minmax_element(
+					CurBatch.Indices.begin(), CurBatch.Indices.end()
+				);
+				IndexAccessor.maxValues.push_back(*IndexMax);
+				IndexAccessor.minValues.push_back(*IndexMin);
 			}
-			NewMaterial.pbrMetallicRoughness.baseColorTexture.texCoord = 0;
-			NewMaterial.pbrMetallicRoughness.baseColorTexture.index
-				= TextureLUT.at(TextureName);
+			IndexAccessor.componentType
+				= TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+			IndexAccessor.count = CurBatch.Indices.size();
+			IndexAccessor.type  = TINYGLTF_TYPE_SCALAR;
+			GLTFModel.accessors.push_back(IndexAccessor);
+
+			NewPrimitive.indices  = GLTFModel.accessors.size() - 1;
+			NewPrimitive.material = MaterialIdx;
+			NewPrimitive.mode     = TINYGLTF_MODE_TRIANGLES;
+
+			tinygltf::Value::Object Extras;
+			Extras["batchRanges"] = tinygltf::Value(CurBatch.Ranges);
+			NewPrimitive.extras   = tinygltf::Value(std::move(Extras));
+
+			NewMesh.primitives.push_back(NewPrimitive);
 		}
-		GLTFModel.materials.push_back(NewMaterial);
-		MaterialLUT.emplace(MaterialName, GLTFModel.materials.size() - 1);
+
+		GLTFModel.meshes.push_back(NewMesh);
+
+		tinygltf::Node NewNode;
+		NewNode.name = NewMesh.name;
+		NewNode.mesh = GLTFModel.meshes.size() - 1;
+		GLTFModel.nodes.push_back(NewNode);
+		GLTFModel.scenes.at(0).nodes.push_back(GLTFModel.nodes.size() - 1);
 	}
-	void VisitMesh(std::span<const std::byte> Data) override
+	// Path of a texture's file, whose name is upper-cased on disk
+	std::filesystem::path GetTextureURI(std::string_view TextureFileName) const
 	{
-		// s
-		char MeshName[256];
-		Data = ReadFormattedBytes(Data, "s", MeshName);
+		std::filesystem::path TextureURI = TexturePath;
+		TextureURI.replace_filename(ToUpper(TextureFileName));
+		TextureURI.replace_extension(".tga");
+		return TextureURI;
+	}
 
-		std::uint32_t SubmeshCount;
-		Data = ReadFormattedBytes(Data, "l", &SubmeshCount);
+	static std::filesystem::path
+		GetKTX2Path(const std::filesystem::path& TextureURI)
+	{
+		std::filesystem::path Result = TextureURI;
+		Result.replace_extension(".ktx2");
+		return Result;
+	}
 
-		tinygltf::Mesh NewMesh;
-		NewMesh.name = MeshName;
+	static std::string ToUpper(std::string_view String)
+	{
+		std::string Result(String);
+		std::transform(Result.begin(), Result.end(), Result.begin(), ::toupper);
+		return Result;
+	}
 
-		for( std::uint32_t i = 0; i < SubmeshCount; ++i )
+	// Refers to the KTX2 file of a texture, relative to the converted model,
+	// through KHR_texture_basisu. Textures that fail to bake are left as is.
+	void AddBakedTexture(
+		const TextureCache::ImageData& Source,
+		const std::filesystem::path& TextureURI, const std::string& TextureName,
+		tinygltf::Texture& NewTexture
+	)
+	{
+		std::string KTX2URI;
+		try
 		{
-			char MaterialName[256];
-			char GeometryName[256];
-			Data = ReadFormattedBytes(Data, "ss", MaterialName, GeometryName);
-			std::printf(
-				"\t%u : (Material: %s, Geometry: %s)\n", i, MaterialName,
-				GeometryName
+			const std::filesystem::path KTX2Path = Textures->GetKTX2(
+				Source, GetKTX2Path(TextureURI), Options.KaiserMips,
+				Options.Pool
 			);
+			KTX2URI = KTX2Path.lexically_relative(FilePath.parent_path())
+						  .generic_string();
+		}
+		catch( const std::exception& Error )
+		{
+			TSUHAN_TRACE(
+				Info, "\t%s: %s, not baked\n",
+				TextureURI.filename().string().c_str(), Error.what()
+			);
+			return;
+		}
 
-			const auto&         Geo = GeometryLUT.at(GeometryName);
-			tinygltf::Primitive NewPrimitive;
-
-			if( Geo[0] >= 0 )
-			{
-				NewPrimitive.indices = Geo[0];
-			}
-
-			const char* VertexAttributeNames[] = {
-				"POSITION",   // VertexPositionAccessorIdx
-				"NORMAL",     // VertexNormalAccessorIdx
-				"TANGENT",    // VertexTangentAccessorIdx
-				"COLOR_0",    // VertexColorAccessorIdx
-				"WEIGHTS_0",  // VertexWeightsAccessorIdx
-				"JOINTS_0",   // VertexJointsAccessorIdx
-				"TEXCOORD_0", // VertexTexCoordAccessorIdx
-			};
-			for( std::size_t AttributeIndex = 0;
-				 AttributeIndex < std::size(VertexAttributeNames);
-				 ++AttributeIndex )
-			{
-				if( Geo[AttributeIndex + 1] >= 0 )
-				{
-					NewPrimitive
-						.attributes[VertexAttributeNames[AttributeIndex]]
-						= Geo[AttributeIndex + 1];
-				}
-			}
-			NewPrimitive.material = MaterialLUT.at(MaterialName);
-			NewPrimitive.mode     = TINYGLTF_MODE_TRIANGLE_STRIP;
-			NewMesh.primitives.push_back(NewPrimitive);
+		const auto [FoundImage, NewImageAdded]
+			= KTX2LUT.try_emplace(KTX2URI, GLTFModel.images.size());
+		if( NewImageAdded )
+		{
+			tinygltf::Image NewImage;
+			NewImage.name     = TextureName + ": KTX2";
+			NewImage.uri      = KTX2URI;
+			NewImage.mimeType = "image/ktx2";
+			GLTFModel.images.push_back(NewImage);
 		}
 
-		GLTFModel.meshes.push_back(NewMesh);
-		MeshLUT.emplace(MeshName, GLTFModel.meshes.size() - 1);
+		NewTexture.extensions["KHR_texture_basisu"]
+			= tinygltf::Value(tinygltf::Value::Object{
+				{"source", tinygltf::Value(int(FoundImage->second))},
+			});
 	}
+
 	void VisitTexture(std::span<const std::byte> Data) override
 	{
 		// ssllllll
-		PrintFormattedBytes(Data, "ssllllll");
-		char TextureName[256];
-		char TextureFileName[256];
-		Data = ReadFormattedBytes(Data, "ss", TextureName, TextureFileName);
-
-		std::filesystem::path TextureURI(std::regex_replace(
-			FilePath.string(), std::regex("model"), "texture"
-		));
-
-		std::string TextureFileNameUpper(TextureFileName);
-		std::transform(
-			TextureFileNameUpper.begin(), TextureFileNameUpper.end(),
-			TextureFileNameUpper.begin(), ::toupper
-		);
-
-		TextureURI.replace_filename(TextureFileNameUpper);
-		TextureURI.replace_extension(".tga");
-
-		auto MappedImage = mio::mmap_source(TextureURI.string().c_str());
+		const auto TextureFields = Parse<"ssllllll">(Data);
+		TraceFields(TextureFields);
+		const std::string TextureName(std::get<0>(TextureFields));
+		const std::string TextureFileName(std::get<1>(TextureFields));
+
+		// Packed textures are drawn from their atlas page instead
+		if( const auto FoundRegion = AtlasLUT.find(TextureName);
+			FoundRegion != AtlasLUT.end() )
+		{
+			TSUHAN_TRACE(
+				Info, "\t%s: Packed into atlas page %u\n", TextureName.c_str(),
+				FoundRegion->second.Page
+			);
+			return;
+		}
 
-		tinygltf::Buffer ImageBuffer;
-		ImageBuffer.name = TextureFileNameUpper + ": Buffer";
-		ImageBuffer.data.assign(MappedImage.begin(), MappedImage.end());
-		GLTFModel.buffers.push_back(ImageBuffer);
+		const std::string TextureFileNameUpper = ToUpper(TextureFileName);
+		const TextureCache::ImageData Source
+			= Textures->Load(GetTextureURI(TextureFileName));
 
-		tinygltf::BufferView ImageBufferView;
-		ImageBufferView.name       = TextureFileNameUpper + ": BufferView";
-		ImageBufferView.buffer     = GLTFModel.buffers.size() - 1;
-		ImageBufferView.byteLength = MappedImage.size();
+		// Embedded as-is if it can not be transcoded
+		TextureCache::ImageData Image    = Source;
+		const char*             MimeType = "image/tga";
+		try
+		{
+			Image    = Textures->GetPNG(Source);
+			MimeType = "image/png";
+		}
+		catch( const std::exception& Error )
+		{
+			TSUHAN_TRACE(
+				Info, "\t%s: %s, embedded as TGA\n",
+				TextureFileNameUpper.c_str(), Error.what()
+			);
+		}
 
-		GLTFModel.bufferViews.push_back(ImageBufferView);
+		// Textures with identical contents refer to the same image
+		const auto [FoundImage, NewImageAdded]
+			= ImageLUT.try_emplace(Image.get(), GLTFModel.images.size());
+		if( NewImageAdded )
+		{
+			const std::int32_t ImageBufferViewIdx
+				= AddBufferView(TextureFileNameUpper + ": BufferView");
+			WriteBufferView(ImageBufferViewIdx, Image->Data);
 
-		tinygltf::Image NewImage;
-		NewImage.name = TextureName;
+			tinygltf::Image NewImage;
+			NewImage.name = TextureName;
 
-		NewImage.bufferView = GLTFModel.bufferViews.size() - 1;
-		NewImage.mimeType   = "image/tga";
-		// NewImage.uri        = TextureFileNameUpper;
+			NewImage.bufferView = ImageBufferViewIdx;
+			NewImage.mimeType   = MimeType;
+			// NewImage.uri        = TextureFileNameUpper;
 
-		GLTFModel.images.push_back(NewImage);
+			GLTFModel.images.push_back(NewImage);
+		}
+		else
+		{
+			TSUHAN_TRACE(
+				Info, "\t%s: Same image as %s\n", TextureName.c_str(),
+				GLTFModel.images[FoundImage->second].name.c_str()
+			);
+		}
 
 		tinygltf::Texture NewTexture;
 		NewTexture.name   = TextureName;
-		NewTexture.source = GLTFModel.images.size() - 1;
+		NewTexture.source = FoundImage->second;
+
+		if( Options.BakeTextures )
+		{
+			AddBakedTexture(
+				Source, GetTextureURI(TextureFileName), TextureName, NewTexture
+			);
+		}
 
 		if( TextureLUT.contains(TextureName) )
 		{
@@ -908,22 +2658,53 @@ public:
 			GLTFModel.textures.push_back(NewTexture);
 			TextureLUT.emplace(TextureName, GLTFModel.textures.size() - 1);
 		}
+
+		// Textures that can not be decoded are assumed to be opaque
+		AlphaCoverage Coverage = AlphaCoverage::Opaque;
+		try
+		{
+			Coverage = Textures->GetAlphaCoverage(Source);
+		}
+		catch( const std::exception& )
+		{
+		}
+		static constexpr const char* CoverageNames[] = {
+			"Opaque",
+			"Cut-out",
+			"Translucent",
+		};
+		TSUHAN_TRACE(
+			Verbose, "\t%s: %s alpha\n", TextureName.c_str(),
+			CoverageNames[std::size_t(Coverage)]
+		);
+
+		const std::uint32_t TextureIdx = TextureLUT.at(TextureName);
+		TextureCoverageLUT.insert_or_assign(TextureIdx, Coverage);
+		for( tinygltf::Material& CurMaterial : GLTFModel.materials )
+		{
+			if( CurMaterial.pbrMetallicRoughness.baseColorTexture.index
+				== std::int32_t(TextureIdx) )
+			{
+				SetAlphaMode(CurMaterial, Coverage);
+			}
+		}
 	}
 	void VisitTransform(std::span<const std::byte> Data) override
 	{
-		// sllllllllll
-		PrintFormattedBytes(Data, "slfffffffff");
-		char          TransformName[256];
-		std::uint32_t Unknown1;
-		glm::vec3     Position = {};
-		glm::vec3     Rotation = {};
-		glm::vec3     Scale    = {};
-
-		Data = ReadFormattedBytes(
-			Data, "slfffffffff", TransformName, &Unknown1, &Position[0],
-			&Position[1], &Position[2], &Rotation[0], &Rotation[1],
-			&Rotation[2], &Scale[0], &Scale[1], &Scale[2]
-		);
+		// slfffffffff
+		const auto NameFields     = Parse<"sl">(Data);
+		const auto PositionFields = Parse<"fff">(Data);
+		const auto RotationFields = Parse<"fff">(Data);
+		const auto ScaleFields    = Parse<"fff">(Data);
+		TraceFields(std::tuple_cat(
+			NameFields, PositionFields, RotationFields, ScaleFields
+		));
+
+		const auto [TransformName, Unknown1] = NameFields;
+
+		const auto Position = std::make_from_tuple<glm::vec3>(PositionFields);
+		const auto Rotation = std::make_from_tuple<glm::vec3>(RotationFields);
+		const auto Scale    = std::make_from_tuple<glm::vec3>(ScaleFields);
 
 		tinygltf::Node NewNode;
 
@@ -953,20 +2734,55 @@ public:
 	{
 		// Nothing seems to use this
 		// sssll
-		Data = PrintFormattedBytes(Data, "sssll");
+		TraceFields(Parse<"sssll">(Data));
 	}
 	void VisitUnknown8(std::span<const std::byte> Data) override
 	{
 		// Nothing seems to use this
 		// sl
-		Data = PrintFormattedBytes(Data, "sl");
+		TraceFields(Parse<"sl">(Data));
 	}
 	void VisitUnknown9(std::span<const std::byte> Data) override
 	{
 		// Nothing seems to use this
 		// sl
-		Data = PrintFormattedBytes(Data, "sl");
+		TraceFields(Parse<"sl">(Data));
+	}
+	// Quantized positions are mapped back onto the model by a child node
+	// holding the dequantization transform
+	void AttachMesh(std::uint32_t NodeIndex, std::uint32_t MeshIndex)
+	{
+		if( Options.Batch )
+		{
+			PendingMeshes.at(MeshIndex).Nodes.push_back(NodeIndex);
+			return;
+		}
+
+		if( !Options.Quantize )
+		{
+			GLTFModel.nodes.at(NodeIndex).mesh = MeshIndex;
+			return;
+		}
+
+		if( !DequantizeLUT.contains(NodeIndex) )
+		{
+			tinygltf::Node DequantizeNode;
+			DequantizeNode.name
+				= GLTFModel.nodes.at(NodeIndex).name + ": Dequantize";
+			DequantizeNode.translation.assign(
+				PositionGrid.Offset.begin(), PositionGrid.Offset.end()
+			);
+			DequantizeNode.scale.assign(3, PositionGrid.Scale);
+
+			GLTFModel.nodes.push_back(DequantizeNode);
+			DequantizeLUT.emplace(NodeIndex, GLTFModel.nodes.size() - 1);
+			GLTFModel.nodes.at(NodeIndex).children.push_back(
+				GLTFModel.nodes.size() - 1
+			);
+		}
+		GLTFModel.nodes.at(DequantizeLUT.at(NodeIndex)).mesh = MeshIndex;
 	}
+
 	void VisitSceneDescriptor(std::span<const std::byte> Data) override
 	{
 		// sll
@@ -978,56 +2794,47 @@ public:
 				= [&](std::span<const std::byte> /*Data*/,
 					  auto& self) -> std::span<const std::byte> {
 				++TabLevel;
-				// PrintFormattedBytes(Data, "sll");
-				char          CurrentNodeName[256];
-				std::uint32_t AttributeType;
-				std::uint32_t ParentChildrenCount;
-				Data = ReadFormattedBytes(
-					Data, "sll", CurrentNodeName, &AttributeType,
-					&ParentChildrenCount
-				);
-				std::printf(
-					"%*s-%s(%u)\n", TabLevel * 2, "", CurrentNodeName,
-					AttributeType
+				const auto [CurrentNodeName, AttributeType, ParentChildrenCount]
+					= Parse<"sll">(Data);
+				TSUHAN_TRACE(
+					Verbose, "%*s-%.*s(%u)\n", (int)TabLevel * 2, "",
+					(std::uint32_t)CurrentNodeName.size(),
+					CurrentNodeName.data(), AttributeType
 				);
 
 				// Iterate children data:
 				for( std::size_t i = 0; i < ParentChildrenCount; ++i )
 				{
-					char          ChildNodeName[256];
-					std::uint32_t ChildAttributeType;
-					std::uint32_t ChildChildrenCount;
-					ReadFormattedBytes(
-						Data, "sll", ChildNodeName, &ChildAttributeType,
-						&ChildChildrenCount
-					);
-
-					std::printf(
-						"%*s-Child:%zu/%zu\n", TabLevel * 2, "", i + 1,
-						ParentChildrenCount
+					// Peek at the child's header, the child itself is read
+					// by the recursive call
+					std::span<const std::byte> ChildData = Data;
+					const auto [ChildNodeName, ChildAttributeType]
+						= Parse<"sl">(ChildData);
+
+					TSUHAN_TRACE(
+						Verbose, "%*s-Child:%zu/%u\n", (int)TabLevel * 2, "",
+						i + 1, ParentChildrenCount
 					);
 
 					// 4: Set child
 					if( ChildAttributeType == 4 || ChildAttributeType == 11 )
 					{
 						const auto CurrentNodeIndex
-							= TransformLUT.at(CurrentNodeName);
+							= TransformLUT.at(std::string(CurrentNodeName));
 						const auto ChildNodeIndex
-							= TransformLUT.at(ChildNodeName);
+							= TransformLUT.at(std::string(ChildNodeName));
 						auto& Node = GLTFModel.nodes.at(CurrentNodeIndex);
 						Node.children.push_back(ChildNodeIndex);
 					}
 					// 2: Set Mesh
 					else if( ChildAttributeType == 2 )
 					{
-						const auto MeshIndex = MeshLUT.at(ChildNodeName);
+						const auto MeshIndex
+							= MeshLUT.at(std::string(ChildNodeName));
 
 						const auto CurrentNodeIndex
-							= TransformLUT.at(CurrentNodeName);
-						auto& Node = GLTFModel.nodes.at(CurrentNodeIndex);
-						Node.mesh  = MeshIndex;
-						// auto&      Node      =
-						// GLTFModel.nodes.at(NodeIndex);
+							= TransformLUT.at(std::string(CurrentNodeName));
+						AttachMesh(CurrentNodeIndex, MeshIndex);
 					}
 
 					Data = self(Data, self);
@@ -1041,19 +2848,20 @@ public:
 	}
 	void VisitBone(std::span<const std::byte> Data) override
 	{
-		// sllllllllll
-		PrintFormattedBytes(Data, "slfffffffff");
-		char          TransformName[256];
-		std::uint32_t Unknown1;
-		glm::vec3     Position = {};
-		glm::vec3     Rotation = {};
-		glm::vec3     Scale    = {};
-
-		Data = ReadFormattedBytes(
-			Data, "slfffffffff", TransformName, &Unknown1, &Position[0],
-			&Position[1], &Position[2], &Rotation[0], &Rotation[1],
-			&Rotation[2], &Scale[0], &Scale[1], &Scale[2]
-		);
+		// slfffffffff
+		const auto NameFields     = Parse<"sl">(Data);
+		const auto PositionFields = Parse<"fff">(Data);
+		const auto RotationFields = Parse<"fff">(Data);
+		const auto ScaleFields    = Parse<"fff">(Data);
+		TraceFields(std::tuple_cat(
+			NameFields, PositionFields, RotationFields, ScaleFields
+		));
+
+		const auto [TransformName, Unknown1] = NameFields;
+
+		const auto Position = std::make_from_tuple<glm::vec3>(PositionFields);
+		const auto Rotation = std::make_from_tuple<glm::vec3>(RotationFields);
+		const auto Scale    = std::make_from_tuple<glm::vec3>(ScaleFields);
 
 		tinygltf::Node NewNode;
 
@@ -1081,74 +2889,156 @@ public:
 	}
 };
 
+ChunkIndex::ChunkIndex(std::span<const std::byte> FileData)
+{
+	std::size_t Offset = 0;
+	while( Offset < FileData.size() )
+	{
+		const std::span<const std::byte> ChunkData = FileData.subspan(Offset);
+
+		Chunk CurChunk;
+		if( ChunkData.size() < sizeof(Chunk) )
+		{
+			throw std::out_of_range("Chunk exceeds file size");
+		}
+		std::memcpy(&CurChunk, ChunkData.data(), sizeof(Chunk));
+
+		// The chunk's size includes its header
+		if( CurChunk.Size < sizeof(Chunk) || CurChunk.Size > ChunkData.size() )
+		{
+			throw std::out_of_range("Chunk exceeds file size");
+		}
+
+		Entry& NewEntry = Entries.emplace_back();
+		NewEntry.Tag    = CurChunk.Tag;
+		NewEntry.Offset = Offset;
+		NewEntry.Size   = CurChunk.Size;
+		NewEntry.Data
+			= ChunkData.subspan(sizeof(Chunk), CurChunk.Size - sizeof(Chunk));
+
+		if( const void* Terminator = std::memchr(
+				NewEntry.Data.data(), 0, NewEntry.Data.size()
+			) )
+		{
+			NewEntry.Name = std::string_view(
+				reinterpret_cast<const char*>(NewEntry.Data.data()),
+				static_cast<const std::byte*>(Terminator) - NewEntry.Data.data()
+			);
+		}
+
+		Offset += CurChunk.Size;
+	}
+
+	// Entries no longer move around, so they can be referred to by pointer
+	for( const Entry& CurEntry : Entries )
+	{
+		TagEntries& CurTagEntries = TagLUT[CurEntry.Tag];
+		CurTagEntries.Entries.push_back(&CurEntry);
+		CurTagEntries.NameLUT.emplace(CurEntry.Name, &CurEntry);
+	}
+}
+
+std::span<const ChunkIndex::Entry> ChunkIndex::GetEntries() const
+{
+	return Entries;
+}
+
+std::span<const ChunkIndex::Entry* const>
+	ChunkIndex::GetEntries(TagID Tag) const
+{
+	if( const auto Found = TagLUT.find(Tag); Found != TagLUT.end() )
+	{
+		return Found->second.Entries;
+	}
+	return {};
+}
+
+const ChunkIndex::Entry*
+	ChunkIndex::Find(TagID Tag, std::string_view Name) const
+{
+	if( const auto Found = TagLUT.find(Tag); Found != TagLUT.end() )
+	{
+		if( const auto FoundName = Found->second.NameLUT.find(Name);
+			FoundName != Found->second.NameLUT.end() )
+		{
+			return FoundName->second;
+		}
+	}
+	return nullptr;
+}
+
 void HGMHandler(
 	std::span<const std::byte> FileData, std::filesystem::path FilePath,
 	HGMVisitor& Visitor
 )
+{
+	HGMHandler(ChunkIndex(FileData), Visitor);
+}
+
+void HGMHandler(const ChunkIndex& Index, HGMVisitor& Visitor)
 {
 	Visitor.BeginHGM();
-	while( !FileData.empty() )
+	for( const ChunkIndex::Entry& CurEntry : Index.GetEntries() )
 	{
-		const Chunk& CurChunk
-			= *reinterpret_cast<const Chunk*>(FileData.data());
-
-		const std::span<const std::byte> Data
-			= FileData.subspan(sizeof(Chunk), CurChunk.Size);
-
-		std::printf("%s(%u)\n", ToString(CurChunk.Tag), CurChunk.Size);
+		TSUHAN_TRACE(
+			Info, "%s(%u)\n", ToString(CurEntry.Tag), CurEntry.Size
+		);
 
-		std::printf("\\%s\n", (const char*)Data.data());
+		TSUHAN_TRACE(
+			Verbose, "\\%.*s\n", (std::uint32_t)CurEntry.Name.size(),
+			CurEntry.Name.data()
+		);
 
-		switch( CurChunk.Tag )
+		switch( CurEntry.Tag )
 		{
 		case TagID::Geometry:
 		{
-			Visitor.VisitGeometry(Data);
+			Visitor.VisitGeometry(CurEntry.Data);
 			break;
 		}
 		case TagID::Material:
 		{
-			Visitor.VisitMaterial(Data);
+			Visitor.VisitMaterial(CurEntry.Data);
 			break;
 		}
 		case TagID::Mesh:
 		{
-			Visitor.VisitMesh(Data);
+			Visitor.VisitMesh(CurEntry.Data);
 			break;
 		}
 		case TagID::Texture:
 		{
-			Visitor.VisitTexture(Data);
+			Visitor.VisitTexture(CurEntry.Data);
 			break;
 		}
 		case TagID::Transform:
 		{
-			Visitor.VisitTransform(Data);
+			Visitor.VisitTransform(CurEntry.Data);
 			break;
 		}
 		case TagID::Unknown7:
 		{
-			Visitor.VisitUnknown7(Data);
+			Visitor.VisitUnknown7(CurEntry.Data);
 			break;
 		}
 		case TagID::Unknown8:
 		{
-			Visitor.VisitUnknown8(Data);
+			Visitor.VisitUnknown8(CurEntry.Data);
 			break;
 		}
 		case TagID::Unknown9:
 		{
-			Visitor.VisitUnknown9(Data);
+			Visitor.VisitUnknown9(CurEntry.Data);
 			break;
 		}
 		case TagID::SceneDescriptor:
 		{
-			Visitor.VisitSceneDescriptor(Data);
+			Visitor.VisitSceneDescriptor(CurEntry.Data);
 			break;
 		}
 		case TagID::Bone:
 		{
-			Visitor.VisitBone(Data);
+			Visitor.VisitBone(CurEntry.Data);
 			break;
 		}
 		default:
@@ -1157,17 +3047,46 @@ void HGMHandler(
 		}
 		}
 
-		FileData = FileData.subspan(CurChunk.Size);
 	}
 	Visitor.EndHGM();
 }
 
 void HGMToGLTF(
-	std::span<const std::byte> FileData, std::filesystem::path FilePath
+	std::span<const std::byte> FileData, std::filesystem::path FilePath,
+	const GLTFOptions& Options
 )
 {
-	GLTFConverter Converter(FilePath);
-	HGMHandler(FileData, FilePath, Converter);
+	const ChunkIndex Index(FileData);
+
+	// Batched geometry is transformed as floats
+	GLTFOptions CurOptions = Options;
+	if( CurOptions.Batch )
+	{
+		CurOptions.Quantize = false;
+	}
+	if( CurOptions.MaxSkinJoints )
+	{
+		CurOptions.TriangleList = true;
+	}
+
+	GLTFConverter Converter(FilePath, CurOptions);
+	if( CurOptions.Quantize )
+	{
+		Converter.PreparePositionGrid(Index);
+	}
+	if( CurOptions.AtlasMaxSize )
+	{
+		Converter.PrepareAtlas(Index);
+	}
+	if( CurOptions.Pool )
+	{
+		// Textures are transcoded while geometry is converted
+		ThreadPool::TaskGroup Group;
+		Converter.PrepareTextures(Index, *CurOptions.Pool, Group);
+		Converter.PrepareGeometry(Index, *CurOptions.Pool, Group);
+		CurOptions.Pool->Wait(Group);
+	}
+	HGMHandler(Index, Converter);
 }
 
 } // namespace HGM
@@ -0,0 +1,143 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <TsuHan/TsuHan.hpp>
+
+namespace
+{
+
+void WriteU32(std::vector<std::byte>& Out, std::uint32_t Value)
+{
+	for( std::size_t i = 0; i < 4; ++i )
+	{
+		Out.push_back(static_cast<std::byte>(Value >> (i * 8)));
+	}
+}
+
+// Null-terminated and padded to a multiple of four bytes
+void WriteString(std::vector<std::byte>& Out, std::string_view String)
+{
+	for( const char CurChar : String )
+	{
+		Out.push_back(static_cast<std::byte>(CurChar));
+	}
+	Out.resize(Out.size() + 4 - String.size() % 4);
+}
+
+// A texture chunk for each texture name, referring to a file of that name
+std::vector<std::byte> MakeHGM(std::initializer_list<std::string_view> Names)
+{
+	std::vector<std::byte> Result;
+	for( const std::string_view CurName : Names )
+	{
+		std::vector<std::byte> Data;
+		WriteString(Data, CurName);
+		WriteString(Data, CurName);
+		for( std::size_t i = 0; i < 6; ++i )
+		{
+			WriteU32(Data, 0);
+		}
+
+		WriteU32(
+			Result,
+			static_cast<std::uint32_t>(TsuHan::HGM::TagID::Texture)
+		);
+		WriteU32(Result, static_cast<std::uint32_t>(8 + Data.size()));
+		Result.insert(Result.end(), Data.begin(), Data.end());
+	}
+	return Result;
+}
+
+// An opaque 32-bit true-color TGA of a single color
+void WriteTGA(
+	const std::filesystem::path& Path, std::uint16_t Width,
+	std::uint16_t Height, std::uint8_t Shade
+)
+{
+	std::vector<std::uint8_t> Data(18);
+	Data[2]  = 2; // True-color
+	Data[12] = Width & 0xFF;
+	Data[13] = Width >> 8;
+	Data[14] = Height & 0xFF;
+	Data[15] = Height >> 8;
+	Data[16] = 32;
+	Data[17] = 8; // Alpha bits
+	for( std::size_t i = 0; i < std::size_t(Width) * Height; ++i )
+	{
+		Data.insert(Data.end(), {Shade, Shade, Shade, 0xFF});
+	}
+
+	std::ofstream(Path, std::ios::binary)
+		.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+}
+
+// Converts an HGM of the textures with atlas packing enabled and returns
+// the written .gltf
+std::string ConvertWithAtlas(
+	const std::filesystem::path& ModelPath,
+	std::initializer_list<std::string_view> Names
+)
+{
+	const std::vector<std::byte> FileData = MakeHGM(Names);
+
+	TsuHan::HGM::GLTFOptions Options = {};
+	Options.AtlasMaxSize             = 64;
+	TsuHan::HGM::HGMToGLTF(FileData, ModelPath, Options);
+
+	std::filesystem::path GLTFPath = ModelPath;
+	GLTFPath.replace_extension(".gltf");
+	std::ifstream GLTFFile(GLTFPath, std::ios::binary);
+	return std::string(
+		std::istreambuf_iterator<char>(GLTFFile),
+		std::istreambuf_iterator<char>()
+	);
+}
+
+} // namespace
+
+int main()
+{
+	// Textures are looked up next to the model, with "model" replaced by
+	// "texture" in its path
+	const std::filesystem::path RootPath
+		= std::filesystem::temp_directory_path() / "TsuHanAtlasTest";
+	std::filesystem::remove_all(RootPath);
+	std::filesystem::create_directories(RootPath / "model");
+	std::filesystem::create_directories(RootPath / "texture");
+
+	WriteTGA(RootPath / "texture" / "TEXA.tga", 8, 8, 0x40);
+	WriteTGA(RootPath / "texture" / "TEXB.tga", 16, 8, 0xC0);
+
+	int Result = EXIT_SUCCESS;
+
+	// A single texture is not packed, so nothing uses a texture transform
+	const std::string Single
+		= ConvertWithAtlas(RootPath / "model" / "single.hgm", {"TEXA"});
+	if( Single.find("KHR_texture_transform") != std::string::npos )
+	{
+		std::printf("Single texture declares KHR_texture_transform\n");
+		Result = EXIT_FAILURE;
+	}
+
+	const std::string Packed = ConvertWithAtlas(
+		RootPath / "model" / "packed.hgm", {"TEXA", "TEXB"}
+	);
+	if( Packed.find("KHR_texture_transform") == std::string::npos )
+	{
+		std::printf("Packed textures lack KHR_texture_transform\n");
+		Result = EXIT_FAILURE;
+	}
+
+	std::filesystem::remove_all(RootPath);
+	return Result;
+}